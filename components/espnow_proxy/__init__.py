@@ -2,6 +2,8 @@ from esphome.cpp_generator import Expression, SafeExpType, safe_exp
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome import automation
+import esphome.final_validate as fv
+from esphome.core import CORE
 from esphome.const import (
     CONF_ID,
     CONF_MAC_ADDRESS,
@@ -16,28 +18,176 @@ CONF_NAME_PREFIX = "name_prefix"
 
 CONF_ON_PACKET_DATA = "on_packet_data"
 CONF_ON_COMMAND_DATA = "on_command_data"
+CONF_ON_BINARY_DATA = "on_binary_data"
+CONF_ON_STREAM_DATA = "on_stream_data"
 
 CONF_ON_SEND_STARTED = "on_send_started"
 CONF_ON_SEND_FINISHED = "on_send_finished"
 CONF_ON_SEND_FAILED = "on_send_failed"
+CONF_ON_DELIVERY = "on_delivery"
+CONF_ON_RPC_REQUEST = "on_rpc_request"
+CONF_ON_RPC_RESPONSE = "on_rpc_response"
 
 CONF_COMPLETE_ONLY = "complete_only"  # for send action
-
-DEPENDENCIES = ["logger", "wifi"]
+CONF_DATA = "data"
+CONF_PRIORITY = "priority"
+CONF_WAIT_UNTIL = "wait_until"  # for send action
+CONF_METHOD = "method"  # for call action and on_rpc_request
+CONF_KEY = "key"  # for send action
+
+CONF_SEND_POOL_SIZE = "send_pool_size"
+CONF_RECV_POOL_SIZE = "recv_pool_size"
+CONF_MAX_QUEUE_LENGTH = "max_queue_length"
+CONF_RECV_LIMIT = "recv_limit"
+CONF_RECV_DROP_POLICY = "recv_drop_policy"
+CONF_FLOW_CONTROL = "flow_control"
+
+CONF_WINDOW_SIZE = "window_size"
+CONF_RETRANSMIT_TIMEOUT = "retransmit_timeout"
+CONF_MIN_RETRANSMIT_TIMEOUT = "min_retransmit_timeout"
+CONF_MAX_RETRANSMIT_TIMEOUT = "max_retransmit_timeout"
+CONF_ACK_DELAY = "ack_delay"
+CONF_BROADCAST_MODE = "broadcast_mode"
+CONF_BROADCAST_HISTORY = "broadcast_history"
+
+CONF_PROTOCOL_TASK = "protocol_task"
+CONF_CORE = "core"
+CONF_STACK_SIZE = "stack_size"
+CONF_EVENT_QUEUE_SIZE = "event_queue_size"
+
+CONF_PACKET_LOG = "packet_log"
+CONF_PERSIST_STATE = "persist_state"
+CONF_PERSIST_RESERVE = "persist_reserve"
+CONF_TRACE_SIZE = "trace_size"
+
+CONF_RPC = "rpc"
+CONF_TIMEOUT = "timeout"
+CONF_MAX_PENDING = "max_pending"
+CONF_MAX_METHODS = "max_methods"
+
+CONF_LOOP_BUDGET = "loop_budget"
+CONF_MESSAGES = "messages"
+CONF_TIME = "time"
+
+CONF_BATCHING = "batching"
+CONF_LINGER = "linger"
+
+CONF_FRAGMENTATION = "fragmentation"
+CONF_MAX_MESSAGE_SIZE = "max_message_size"
+CONF_REASSEMBLY_SLOTS = "reassembly_slots"
+CONF_REASSEMBLY_TIMEOUT = "reassembly_timeout"
+
+DEPENDENCIES = ["logger"]
 AUTO_LOAD = []
 
 base_ns = cg.global_ns.namespace("espnow_proxy_base")
 proxy_ns = cg.esphome_ns.namespace("espnow_proxy")
 
+ESPNowProxy = proxy_ns.class_("ESPNowProxy", cg.Component)
 ESPNowProxyPeer = proxy_ns.class_("ESPNowProxyPeer", cg.Component)
 PacketDataTrigger = proxy_ns.class_("PacketDataTrigger", automation.Trigger.template())
 CommandDataTrigger = proxy_ns.class_("CommandDataTrigger", automation.Trigger.template())
+BinaryDataTrigger = proxy_ns.class_("BinaryDataTrigger", automation.Trigger.template())
+StreamDataTrigger = proxy_ns.class_("StreamDataTrigger", automation.Trigger.template())
 
 SendStartedTrigger = proxy_ns.class_("SendStartedTrigger", automation.Trigger.template())
 SendFinishedTrigger = proxy_ns.class_("SendFinishedTrigger", automation.Trigger.template())
 SendFailedTrigger = proxy_ns.class_("SendFailedTrigger", automation.Trigger.template())
+DeliveryTrigger = proxy_ns.class_("DeliveryTrigger", automation.Trigger.template())
+RpcRequestTrigger = proxy_ns.class_("RpcRequestTrigger", automation.Trigger.template())
+RpcResponseTrigger = proxy_ns.class_("RpcResponseTrigger", automation.Trigger.template())
+
+SendAction = proxy_ns.class_("SendAction", automation.Action)
+CallAction = proxy_ns.class_("CallAction", automation.Action)
 
 PacketData = proxy_ns.struct("packet_data_t")
+StreamChunk = proxy_ns.struct("stream_chunk_t")
+RpcRequest = proxy_ns.struct("rpc_request_t")
+
+BROADCAST_MODES = {
+    "ack": 0,
+    "unacked": 1,
+    "nack": 2,
+}
+
+SEND_PRIORITIES = {
+    "control": 0,
+    "telemetry": 1,
+    "bulk": 2,
+}
+
+RECV_DROP_POLICIES = {
+    "newest": 0,
+    "oldest": 1,
+    "priority": 2,
+}
+
+SEND_WAIT_UNTIL = {
+    "queued": False,
+    "acked": True,
+}
+
+
+def softap_alias(address):
+    # softAP address of a device is its station address + 1 in the last byte
+    return (address & ~0xFF) | ((address + 1) & 0xFF)
+
+
+def generate_peer_hash(addresses):
+    # search a multiplier which maps every address to its own slot
+    keys = set()
+    for address in addresses:
+        keys.add(address)
+        keys.add(softap_alias(address))
+    size = 4
+    while size < 2 * len(keys):
+        size *= 2
+    bits = size.bit_length() - 1
+    mult = 0x9E3779B97F4A7C15
+    while True:
+        for _ in range(10000):
+            slots = {((key * mult) & 0xFFFFFFFFFFFFFFFF) >> (64 - bits) for key in keys}
+            if len(slots) == len(keys):
+                return size, mult
+            # next odd multiplier (splitmix64 step)
+            mult = (mult + 0x9E3779B97F4A7C15) & 0xFFFFFFFFFFFFFFFF
+            mult = ((mult ^ (mult >> 31)) * 0xBF58476D1CE4E5B9 & 0xFFFFFFFFFFFFFFFF) | 1
+        size *= 2
+        bits += 1
+
+
+def power_of_two(value):
+    value = cv.positive_not_null_int(value)
+    if value & (value - 1):
+        raise cv.Invalid("Value must be a power of two")
+    return value
+
+
+def validate_recv_limit(config):
+    # dropping queued frames needs a free slot above the limit for the
+    # incoming one, newest just rejects it
+    size = config[CONF_RECV_POOL_SIZE]
+    if CONF_RECV_LIMIT not in config:
+        config[CONF_RECV_LIMIT] = size if config[CONF_RECV_DROP_POLICY] == "newest" else max(size * 3 // 4, 1)
+    limit = config[CONF_RECV_LIMIT]
+    if limit > size:
+        raise cv.Invalid(f"{CONF_RECV_LIMIT} must not be above {CONF_RECV_POOL_SIZE}")
+    if config[CONF_RECV_DROP_POLICY] != "newest" and limit >= size:
+        raise cv.Invalid(f"{CONF_RECV_LIMIT} must be below {CONF_RECV_POOL_SIZE} to drop queued frames")
+    return config
+
+
+def validate_send_pool(config):
+    # every peer and the receiver may fill its queue, the shared pool must
+    # hold all of them so unreachable peers can't starve the others
+    needed = config[CONF_MAX_QUEUE_LENGTH] * (len(config.get(CONF_PEERS, [])) + 1)
+    if CONF_SEND_POOL_SIZE not in config:
+        config[CONF_SEND_POOL_SIZE] = max(needed, 8)
+    if config[CONF_SEND_POOL_SIZE] < needed:
+        raise cv.Invalid(
+            f"{CONF_SEND_POOL_SIZE} must be at least {CONF_MAX_QUEUE_LENGTH} x (peers + 1) = {needed}"
+        )
+    return config
 
 
 class ExplicitClassPtrCast(Expression):
@@ -85,6 +235,12 @@ class Generator:
         cv.Optional(CONF_ON_COMMAND_DATA): automation.validate_automation({
             cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(CommandDataTrigger),
         }),
+        cv.Optional(CONF_ON_BINARY_DATA): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(BinaryDataTrigger),
+        }),
+        cv.Optional(CONF_ON_STREAM_DATA): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(StreamDataTrigger),
+        }),
         cv.Optional(CONF_ON_SEND_STARTED): automation.validate_automation({
             cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(SendStartedTrigger),
         }),
@@ -94,13 +250,19 @@ class Generator:
         cv.Optional(CONF_ON_SEND_FAILED): automation.validate_automation({
             cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(SendFailedTrigger),
         }),
+        cv.Optional(CONF_ON_DELIVERY): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(DeliveryTrigger),
+        }),
+        cv.Optional(CONF_ON_RPC_RESPONSE): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(RpcResponseTrigger),
+        }),
     })
 
     def __init__(self, proxy_id):
         self.proxy_id_ = proxy_id
 
     def proxy_factory(self):
-        return proxy_ns.class_("ESPNowProxy", cg.Component)
+        return ESPNowProxy
 
     def peer_class_factory(self):
         return ESPNowProxyPeer
@@ -111,7 +273,7 @@ class Generator:
         return self.proxy_
 
     def generate_proxy_config(self):
-        schema = self.generate_proxy_schema()
+        schema = cv.All(self.generate_proxy_schema(), validate_recv_limit, validate_send_pool)
         return schema, self.to_code
 
     def generate_peer_schema(self):
@@ -125,6 +287,73 @@ class Generator:
         schema = cv.Schema({
             cv.GenerateID(): cv.declare_id(self.get_receiver()),
             cv.Optional(CONF_MAC_ADDRESS): cv.mac_address,
+            cv.Optional(CONF_SEND_POOL_SIZE): cv.int_range(min=1, max=255),
+            cv.Optional(CONF_RECV_POOL_SIZE, default=16): power_of_two,
+            cv.Optional(CONF_MAX_QUEUE_LENGTH, default=5): cv.int_range(min=1, max=255),
+            # frames queued before the receive drop policy applies
+            cv.Optional(CONF_RECV_LIMIT): cv.int_range(min=1, max=4096),
+            cv.Optional(CONF_RECV_DROP_POLICY, default="newest"): cv.one_of(*RECV_DROP_POLICIES, lower=True),
+            cv.Optional(CONF_FLOW_CONTROL, default=True): cv.boolean,
+            cv.Optional(CONF_WINDOW_SIZE, default=4): cv.int_range(min=1, max=16),
+            cv.Optional(
+                CONF_RETRANSMIT_TIMEOUT, default="250ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_MIN_RETRANSMIT_TIMEOUT, default="20ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_MAX_RETRANSMIT_TIMEOUT, default="2000ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_ACK_DELAY, default="10ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_BROADCAST_MODE, default="ack"): cv.enum(BROADCAST_MODES, lower=True),
+            cv.Optional(
+                CONF_BROADCAST_HISTORY, default="200ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_LOOP_BUDGET, default={}): cv.Schema({
+                cv.Optional(CONF_MESSAGES, default=8): cv.int_range(min=1, max=255),
+                cv.Optional(
+                    CONF_TIME, default="2000us"
+                ): cv.positive_time_period_microseconds,
+            }),
+            cv.Optional(CONF_PERSIST_STATE, default=False): cv.boolean,
+            # at least the receive window (SEQ_WINDOW_LEN)
+            cv.Optional(CONF_PERSIST_RESERVE, default=256): cv.int_range(min=32, max=16384),
+            cv.Optional(CONF_PACKET_LOG, default=False): cv.boolean,
+            cv.Optional(CONF_TRACE_SIZE): cv.int_range(min=16, max=4096),
+            cv.Optional(CONF_RPC, default={}): cv.Schema({
+                cv.Optional(
+                    CONF_TIMEOUT, default="1000ms"
+                ): cv.positive_time_period_milliseconds,
+                cv.Optional(CONF_MAX_PENDING, default=8): cv.int_range(min=1, max=64),
+                cv.Optional(CONF_MAX_METHODS, default=8): cv.int_range(min=1, max=255),
+            }),
+            # methods answered by this node, registered on the proxy only
+            cv.Optional(CONF_ON_RPC_REQUEST): automation.validate_automation({
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(RpcRequestTrigger),
+                cv.Required(CONF_METHOD): cv.uint8_t,
+            }),
+            cv.Optional(CONF_PROTOCOL_TASK): cv.Schema({
+                cv.Optional(CONF_PRIORITY, default=5): cv.int_range(min=1, max=24),
+                cv.Optional(CONF_CORE, default=1): cv.int_range(min=-1, max=1),
+                cv.Optional(CONF_STACK_SIZE, default=4096): cv.int_range(min=2048, max=32768),
+                cv.Optional(CONF_EVENT_QUEUE_SIZE, default=16): power_of_two,
+            }),
+            cv.Optional(CONF_BATCHING): cv.Schema({
+                cv.Optional(
+                    CONF_LINGER, default="10ms"
+                ): cv.positive_time_period_milliseconds,
+            }),
+            cv.Optional(CONF_FRAGMENTATION): cv.Schema({
+                cv.Optional(
+                    CONF_MAX_MESSAGE_SIZE, default=4096
+                ): cv.int_range(min=1, max=65535),
+                cv.Optional(CONF_REASSEMBLY_SLOTS, default=4): cv.int_range(min=1, max=64),
+                cv.Optional(
+                    CONF_REASSEMBLY_TIMEOUT, default="5s"
+                ): cv.positive_time_period_milliseconds,
+            }),
             cv.Optional(CONF_PEERS): cv.ensure_list(
                 self.generate_peer_schema()
             )
@@ -162,6 +391,36 @@ class Generator:
                 conf,
             )
 
+        for conf in config.get(CONF_ON_BINARY_DATA, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+
+            if CONF_MAC_ADDRESS in config:
+                cg.add(trigger.set_peer_address(config[CONF_MAC_ADDRESS].as_hex))
+
+            await automation.build_automation(
+                trigger,
+                [
+                    (cg.uint64.operator("const"), "address"),
+                    (cg.std_string.operator("const"), "x"),
+                ],
+                conf,
+            )
+
+        for conf in config.get(CONF_ON_STREAM_DATA, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+
+            if CONF_MAC_ADDRESS in config:
+                cg.add(trigger.set_peer_address(config[CONF_MAC_ADDRESS].as_hex))
+
+            await automation.build_automation(
+                trigger,
+                [
+                    (cg.uint64.operator("const"), "address"),
+                    (StreamChunk.operator("const"), "x"),
+                ],
+                conf,
+            )
+
         for conf in config.get(CONF_ON_SEND_STARTED, []):
             trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
             await automation.build_automation(trigger, [], conf)
@@ -174,6 +433,39 @@ class Generator:
             trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
             await automation.build_automation(trigger, [], conf)
 
+        for conf in config.get(CONF_ON_DELIVERY, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+
+            if CONF_MAC_ADDRESS in config:
+                cg.add(trigger.set_peer_address(config[CONF_MAC_ADDRESS].as_hex))
+
+            await automation.build_automation(
+                trigger,
+                [
+                    (cg.uint64.operator("const"), "address"),
+                    (cg.uint32.operator("const"), "id"),
+                    (cg.uint8.operator("const"), "status"),
+                ],
+                conf,
+            )
+
+        for conf in config.get(CONF_ON_RPC_RESPONSE, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+
+            if CONF_MAC_ADDRESS in config:
+                cg.add(trigger.set_peer_address(config[CONF_MAC_ADDRESS].as_hex))
+
+            await automation.build_automation(
+                trigger,
+                [
+                    (cg.uint64.operator("const"), "address"),
+                    (cg.uint8.operator("const"), "method"),
+                    (cg.uint8.operator("const"), "status"),
+                    (cg.std_string.operator("const"), "x"),
+                ],
+                conf,
+            )
+
     async def to_code_peer(self, component, config, ID_PROP):
         # add to peer registry
         mac_address_str = str(config[CONF_MAC_ADDRESS])
@@ -210,6 +502,86 @@ class Generator:
             cg.add(var.set_address(config[CONF_MAC_ADDRESS].as_hex))
         await cg.register_component(var, config)
 
+        cg.add(var.set_max_queue_length(config[CONF_MAX_QUEUE_LENGTH]))
+        cg.add(var.set_window_size(config[CONF_WINDOW_SIZE]))
+        cg.add(var.set_retransmit_timeout(config[CONF_RETRANSMIT_TIMEOUT]))
+        cg.add(var.set_min_retransmit_timeout(config[CONF_MIN_RETRANSMIT_TIMEOUT]))
+        cg.add(var.set_max_retransmit_timeout(config[CONF_MAX_RETRANSMIT_TIMEOUT]))
+        cg.add(var.set_ack_delay(config[CONF_ACK_DELAY]))
+        cg.add(var.set_broadcast_mode(config[CONF_BROADCAST_MODE]))
+        cg.add(var.set_broadcast_history(config[CONF_BROADCAST_HISTORY]))
+        cg.add(var.set_flow_control(config[CONF_FLOW_CONTROL]))
+        cg.add(var.set_recv_limit(config[CONF_RECV_LIMIT]))
+        cg.add(var.set_recv_drop_policy(RECV_DROP_POLICIES[config[CONF_RECV_DROP_POLICY]]))
+
+        if CONF_BATCHING in config:
+            cg.add(var.set_batching(True))
+            cg.add(var.set_batch_linger(config[CONF_BATCHING][CONF_LINGER]))
+
+        # pool capacities are fixed at compile time
+        cg.add_define("SEND_POOL_LEN", config[CONF_SEND_POOL_SIZE])
+        cg.add_define("RECV_QUEUE_LEN", config[CONF_RECV_POOL_SIZE])
+        # delivery status slots, every pooled message twice
+        delivery_len = 32
+        while delivery_len < 2 * (config[CONF_SEND_POOL_SIZE] + 1):
+            delivery_len *= 2
+        cg.add_define("DELIVERY_LEN", delivery_len)
+
+        loop_budget = config[CONF_LOOP_BUDGET]
+        cg.add(var.set_loop_budget_messages(loop_budget[CONF_MESSAGES]))
+        cg.add(var.set_loop_budget_time(loop_budget[CONF_TIME]))
+
+        rpc = config[CONF_RPC]
+        cg.add(var.set_rpc_timeout(rpc[CONF_TIMEOUT]))
+        cg.add_define("RPC_PENDING_LEN", rpc[CONF_MAX_PENDING])
+        cg.add_define("RPC_METHOD_LEN", rpc[CONF_MAX_METHODS])
+        for conf in config.get(CONF_ON_RPC_REQUEST, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var, conf[CONF_METHOD])
+            await automation.build_automation(
+                trigger,
+                [
+                    (RpcRequest.operator("const"), "request"),
+                    (cg.std_string.operator("const"), "x"),
+                ],
+                conf,
+            )
+
+        cg.add(var.set_persist_state(config[CONF_PERSIST_STATE]))
+        cg.add(var.set_persist_reserve(config[CONF_PERSIST_RESERVE]))
+        # every configured peer is persisted
+        cg.add_define("PERSIST_PEER_LEN", max(1, len(config.get(CONF_PEERS, []))))
+
+        # packet path logging and tracing are compiled out unless enabled
+        if config[CONF_PACKET_LOG]:
+            cg.add_define("USE_ESPNOW_PROXY_PACKET_LOG")
+        if CONF_TRACE_SIZE in config:
+            cg.add_define("USE_ESPNOW_PROXY_TRACE")
+            cg.add_define("TRACE_LEN", config[CONF_TRACE_SIZE])
+
+        if CONF_PROTOCOL_TASK in config:
+            task = config[CONF_PROTOCOL_TASK]
+            cg.add_define("USE_ESPNOW_PROXY_TASK")
+            cg.add_define("EVENT_QUEUE_LEN", task[CONF_EVENT_QUEUE_SIZE])
+            cg.add(var.set_task_priority(task[CONF_PRIORITY]))
+            cg.add(var.set_task_core(task[CONF_CORE]))
+            cg.add(var.set_task_stack_size(task[CONF_STACK_SIZE]))
+
+        if CONF_FRAGMENTATION in config:
+            fragmentation = config[CONF_FRAGMENTATION]
+            cg.add_define("USE_ESPNOW_PROXY_FRAGMENTATION")
+            cg.add_define("MAX_MESSAGE_LEN", fragmentation[CONF_MAX_MESSAGE_SIZE])
+            cg.add_define("FRAGMENT_POOL_LEN", fragmentation[CONF_REASSEMBLY_SLOTS])
+            cg.add(var.set_reassembly_timeout(fragmentation[CONF_REASSEMBLY_TIMEOUT]))
+
+        # peer lookup table with a perfect hash over the configured addresses
+        addresses = [
+            int.from_bytes(bytes(peer[CONF_MAC_ADDRESS].parts), "big")
+            for peer in config.get(CONF_PEERS, [])
+        ]
+        table_size, table_mult = generate_peer_hash(addresses)
+        cg.add_define("PEER_TABLE_LEN", table_size)
+        cg.add_define("PEER_HASH_MULT", cg.RawExpression(f"0x{table_mult:016X}ULL"))
+
         if CONF_PEERS in config:
             for _, config_item in enumerate(config[CONF_PEERS]):
                 await self.to_code_peer(var, config_item, CONF_ID)
@@ -221,3 +593,63 @@ class Generator:
 
 gen = Generator(CONF_ESPNowProxy_ID)
 CONFIG_SCHEMA, to_code = gen.generate_proxy_config()
+
+
+def final_validate(config):
+    # esp now runs on the wifi radio, host builds use the simulated medium
+    if not CORE.is_host and "wifi" not in fv.full_config.get():
+        raise cv.Invalid("espnow_proxy requires the wifi component")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = final_validate
+
+
+@automation.register_action(
+    "espnow_proxy.send",
+    SendAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(ESPNowProxy),
+        cv.Required(CONF_DATA): cv.templatable(cv.string),
+        cv.Optional(CONF_MAC_ADDRESS): cv.mac_address,
+        cv.Optional(CONF_PRIORITY, default="telemetry"): cv.enum(SEND_PRIORITIES, lower=True),
+        cv.Optional(CONF_WAIT_UNTIL, default="queued"): cv.enum(SEND_WAIT_UNTIL, lower=True),
+        cv.Optional(CONF_KEY): cv.int_range(min=1, max=255),
+    }),
+)
+async def send_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    template_ = await cg.templatable(config[CONF_DATA], args, cg.std_string)
+    cg.add(var.set_data(template_))
+    if CONF_MAC_ADDRESS in config:
+        cg.add(var.set_address(config[CONF_MAC_ADDRESS].as_hex))
+    cg.add(var.set_priority(config[CONF_PRIORITY]))
+    cg.add(var.set_wait_acked(config[CONF_WAIT_UNTIL]))
+    if CONF_KEY in config:
+        cg.add(var.set_key(config[CONF_KEY]))
+    return var
+
+
+@automation.register_action(
+    "espnow_proxy.call",
+    CallAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(ESPNowProxy),
+        cv.Required(CONF_METHOD): cv.uint8_t,
+        cv.Optional(CONF_DATA, default=""): cv.templatable(cv.string),
+        cv.Optional(CONF_MAC_ADDRESS): cv.mac_address,
+        cv.Optional(CONF_TIMEOUT): cv.positive_time_period_milliseconds,
+    }),
+)
+async def call_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    template_ = await cg.templatable(config[CONF_DATA], args, cg.std_string)
+    cg.add(var.set_data(template_))
+    cg.add(var.set_method(config[CONF_METHOD]))
+    if CONF_MAC_ADDRESS in config:
+        cg.add(var.set_address(config[CONF_MAC_ADDRESS].as_hex))
+    if CONF_TIMEOUT in config:
+        cg.add(var.set_timeout(config[CONF_TIMEOUT]))
+    return var
@@ -16,7 +16,7 @@ namespace espnow_proxy {
     class PacketDataTrigger : public Trigger<const mac_address_t, const packet_data_t> {
         public:
             explicit PacketDataTrigger(EventTarget *parent) {
-                parent->add_on_packet_data_callback([this](const mac_address_t address, const packet_data_t x) {
+                parent->add_on_packet_data_callback([this](const mac_address_t address, const packet_data_t &x) {
                     // filter packet on address if peer
                     if ((!peer_address_ || peer_address_ == address)) {
                         trigger(address, x);
@@ -32,8 +32,41 @@ namespace espnow_proxy {
     class CommandDataTrigger : public Trigger<const mac_address_t, const std::string> {
         public:
             explicit CommandDataTrigger(EventTarget *parent) {
-                parent->add_on_command_data_callback([this](const mac_address_t address, const std::string x) {
-                    // filter command on address if peer
+                parent->add_on_command_data_callback([this](const mac_address_t address, std::string_view x) {
+                    // filter command on address if peer, text ends at the terminator
+                    if ((!peer_address_ || peer_address_ == address)) {
+                        trigger(address, std::string(x.data(), strnlen(x.data(), x.size())));
+                    }
+                });
+            }
+            void set_peer_address(mac_address_t value) { peer_address_ = value; };
+
+        private:
+            mac_address_t peer_address_{0};
+    };
+
+    class BinaryDataTrigger : public Trigger<const mac_address_t, const std::string> {
+        public:
+            explicit BinaryDataTrigger(EventTarget *parent) {
+                parent->add_on_command_data_callback([this](const mac_address_t address, std::string_view x) {
+                    // filter data on address if peer, the receive slot is freed after
+                    // the callback so the data is copied for actions that wait
+                    if ((!peer_address_ || peer_address_ == address)) {
+                        trigger(address, std::string(x));
+                    }
+                });
+            }
+            void set_peer_address(mac_address_t value) { peer_address_ = value; };
+
+        private:
+            mac_address_t peer_address_{0};
+    };
+
+    class StreamDataTrigger : public Trigger<const mac_address_t, const stream_chunk_t> {
+        public:
+            explicit StreamDataTrigger(EventTarget *parent) {
+                parent->add_on_stream_data_callback([this](const mac_address_t address, const stream_chunk_t x) {
+                    // filter chunk on address if peer
                     if ((!peer_address_ || peer_address_ == address)) {
                         trigger(address, x);
                     }
@@ -45,6 +78,142 @@ namespace espnow_proxy {
             mac_address_t peer_address_{0};
     };
 
+    template<typename... Ts> class SendAction : public Action<Ts...>, public Parented<ESPNowProxy> {
+        public:
+            TEMPLATABLE_VALUE(std::string, data)
+
+            void set_address(mac_address_t value) { options_.address = value; };
+            void set_priority(uint8_t value) { options_.priority = value; };
+            void set_key(uint8_t value) { options_.key = value; };
+            void set_wait_acked(bool value) { wait_acked_ = value; };
+
+            void play_complex(Ts... x) override {
+                if (!wait_acked_) {
+                    Action<Ts...>::play_complex(x...);
+                    return;
+                }
+
+                // the following actions run once the receiver confirmed the
+                // message, a timed out or dropped message ends the automation
+                this->num_running_++;
+                send_options_t options = options_;
+                uint32_t generation = generation_;
+                options.on_delivery = [this, generation, x...](delivery_handle_t handle, uint8_t status) {
+                    if (generation != generation_) {
+                        return;
+                    }
+                    if (status == Delivery_Acked || status == Delivery_Sent) {
+                        this->play_next_(x...);
+                    } else if (this->num_running_ > 0) {
+                        this->num_running_--;
+                    }
+                };
+                this->parent_->send(this->data_.value(x...), options);
+            }
+
+            void play(Ts... x) override {
+                this->parent_->send(this->data_.value(x...), options_);
+            }
+
+            void stop() override {
+                // pending deliveries no longer continue this automation
+                generation_++;
+            }
+
+        private:
+            send_options_t options_{};
+            bool wait_acked_{false};
+            uint32_t generation_{0};
+    };
+
+    class DeliveryTrigger : public Trigger<const mac_address_t, const uint32_t, const uint8_t> {
+        public:
+            explicit DeliveryTrigger(EventTarget *parent) {
+                parent->add_on_delivery_callback([this](const mac_address_t address, uint32_t id, uint8_t status) {
+                    // filter delivery on address if peer
+                    if ((!peer_address_ || peer_address_ == address)) {
+                        trigger(address, id, status);
+                    }
+                });
+            }
+            void set_peer_address(mac_address_t value) { peer_address_ = value; };
+
+        private:
+            mac_address_t peer_address_{0};
+    };
+
+    class RpcRequestTrigger : public Trigger<const rpc_request_t, const std::string> {
+        public:
+            // handler of the method, the automation answers with respond(), the
+            // data is copied as the automation may answer after a delay
+            RpcRequestTrigger(ESPNowProxy *parent, uint8_t method) {
+                parent->register_method(method, [this](const rpc_request_t &request, std::string_view x) {
+                    trigger(request, std::string(x));
+                });
+            }
+    };
+
+    class RpcResponseTrigger : public Trigger<const mac_address_t, const uint8_t, const uint8_t, const std::string> {
+        public:
+            explicit RpcResponseTrigger(EventTarget *parent) {
+                parent->add_on_rpc_response_callback(
+                    [this](const mac_address_t address, uint8_t method, uint8_t status, std::string_view x) {
+                        // filter response on address if peer, data is copied
+                        if ((!peer_address_ || peer_address_ == address)) {
+                            trigger(address, method, status, std::string(x));
+                        }
+                    });
+            }
+            void set_peer_address(mac_address_t value) { peer_address_ = value; };
+
+        private:
+            mac_address_t peer_address_{0};
+    };
+
+    template<typename... Ts> class CallAction : public Action<Ts...>, public Parented<ESPNowProxy> {
+        public:
+            TEMPLATABLE_VALUE(std::string, data)
+
+            void set_address(mac_address_t value) { address_ = value; };
+            void set_method(uint8_t value) { method_ = value; };
+            void set_timeout(uint32_t value) { timeout_ = value; };
+
+            void play_complex(Ts... x) override {
+                // the following actions run once the call succeeded, errors
+                // and timeouts end the automation
+                this->num_running_++;
+                uint32_t generation = generation_;
+                this->parent_->call(
+                    address_, method_, this->data_.value(x...),
+                    [this, generation, x...](uint8_t status, std::string_view response) {
+                        if (generation != generation_) {
+                            return;
+                        }
+                        if (status == Rpc_Ok) {
+                            this->play_next_(x...);
+                        } else if (this->num_running_ > 0) {
+                            this->num_running_--;
+                        }
+                    },
+                    timeout_);
+            }
+
+            void play(Ts... x) override {
+                this->parent_->call(address_, method_, this->data_.value(x...), nullptr, timeout_);
+            }
+
+            void stop() override {
+                // pending calls no longer continue this automation
+                generation_++;
+            }
+
+        private:
+            mac_address_t address_{0};
+            uint8_t method_{0};
+            uint32_t timeout_{0};
+            uint32_t generation_{0};
+    };
+
     class SendStartedTrigger : public Trigger<> {
         public:
             explicit SendStartedTrigger(ESPNowProxy *parent) {
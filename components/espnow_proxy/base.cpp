@@ -7,92 +7,188 @@ namespace espnow_proxy_base {
 
     send_callback_t send_callbacks_[MAX_CALLBACKS];
     recv_callback_t recv_callbacks_[MAX_CALLBACKS];
+    uint8_t send_callback_nodes_[MAX_CALLBACKS];  // radio node registering the callback
+    uint8_t recv_callback_nodes_[MAX_CALLBACKS];
     uint8_t send_callback_idx_ = 0;
     uint8_t recv_callback_idx_ = 0;
-    State state_;
+    State states_[RADIO_NODE_LEN];  // one per radio node, a single one on the device
+    tx_frame_t frames_[RADIO_NODE_LEN][TX_FRAME_POOL_LEN];
+    std::atomic<uint32_t> frame_seq_{0};
+    peer_registry_t registries_[RADIO_NODE_LEN];
 
     // internal
 
-    void set_sending_(bool sending) {
-        state_.is_sending = sending;
+    State &state_() {
+        return states_[radio_node()];
     }
 
     void set_success_(bool success) {
-        state_.is_success = success;
+        state_().is_success = success;
     }
 
     void inc_sent_error_() {
-        state_.sent_error++;
+        state_().sent_error++;
     }
 
     void inc_received_() {
-        state_.received++;
+        state_().received++;
     }
 
     void inc_sent_() {
-        state_.sent++;
+        state_().sent++;
     }
 
     void set_sender_(uint8_t *sender) {
-        state_.sender = sender;
-    }
-
-    void set_send_time_(uint32_t time) {
-        state_.send_time = time;
+        state_().sender = sender;
     }
 
     uint16_t calc_duration_(uint32_t start_time) {
-        return micros() - start_time;
+        return clock_micros() - start_time;
     }
 
     // peers
 
-    bool add_peer(const uint8_t *peer, int channel, int netif) {
-        if (!is_ready()) {
-            return false;
+    peer_registry_t &registry_() {
+        return registries_[radio_node()];
+    }
+
+    peer_registry_entry_t *find_peer_(const uint8_t *peer) {
+        peer_registry_t &registry = registry_();
+        mac_address_t address = addr_to_addr64(peer);
+        for (auto i = 0; i < registry.count; i++) {
+            if (registry.entries[i].address == address) {
+                return &registry.entries[i];
+            }
         }
+        return nullptr;
+    }
 
-        esp_now_peer_info_t peer_info{};
-        std::copy_n(peer, MAC_ADDRESS_LEN, peer_info.peer_addr);
+    tx_frame_t *oldest_in_flight_(const uint8_t *dest=nullptr);
+
+    // least recently used entry, only registered ones if registered is set.
+    // the broadcast peer and peers with frames in flight are kept, the radio
+    // would fail their completions. nullptr if every peer is in use
+    peer_registry_entry_t *find_lru_(bool registered) {
+        peer_registry_t &registry = registry_();
+        peer_registry_entry_t *lru = nullptr;
+        for (auto i = 0; i < registry.count; i++) {
+            peer_registry_entry_t *entry = &registry.entries[i];
+            if (
+                (registered && !entry->registered) || (lru && entry->last_used >= lru->last_used) ||
+                entry->address == addr_to_addr64(BROADCAST) || oldest_in_flight_(addr64_to_addr(entry->address))
+            ) {
+                continue;
+            }
+            lru = entry;
+        }
+        return lru;
+    }
 
-        peer_info.channel = static_cast<uint8_t>(channel);
-        peer_info.ifidx = static_cast<wifi_interface_t>(netif);
+    void unregister_peer_(peer_registry_entry_t *entry) {
+        if (!entry->registered) {
+            return;
+        }
+        radio_remove_peer(addr64_to_addr(entry->address));
+        entry->registered = false;
+        registry_().registered--;
+    }
 
-        if (has_peer(peer)) {
-            ESP_LOGD(TAG, "Peer %s already exists", addr_to_str(peer).c_str());
-            return esp_now_mod_peer(&peer_info) == ESP_OK;
+    // make sure the peer is in the radio peer table, evicts the least
+    // recently used peer if the table is full
+    bool register_peer_(peer_registry_entry_t *entry) {
+        if (!entry) {
+            return false;
+        }
+        peer_registry_t &registry = registry_();
+        entry->last_used = ++registry.clock;
+        if (entry->registered) {
+            registry.hits++;
+            return true;
         }
-        ESP_LOGD(TAG, "Adding peer %s", addr_to_str(peer).c_str());
-        return esp_now_add_peer(&peer_info) == ESP_OK;
+        registry.misses++;
+        if (registry.registered >= RADIO_PEER_LEN) {
+            peer_registry_entry_t *lru = find_lru_(true);
+            if (!lru) {
+                PACKET_LOGD(TAG, "No peer to evict, all are in use");
+                return false;
+            }
+            PACKET_LOGD(TAG, "Evicting peer %s", mac_str(lru->address).c_str());
+            unregister_peer_(lru);
+            registry.evictions++;
+        }
+        uint8_t addr[MAC_ADDRESS_LEN];
+        memcpy(addr, addr64_to_addr(entry->address), MAC_ADDRESS_LEN);
+        if (!radio_add_peer(addr, entry->channel, entry->ifidx)) {
+            return false;
+        }
+        entry->registered = true;
+        registry.registered++;
+        return true;
+    }
+
+    peer_registry_entry_t *insert_peer_(const uint8_t *peer, uint8_t channel, uint8_t ifidx) {
+        peer_registry_t &registry = registry_();
+        peer_registry_entry_t *entry = find_peer_(peer);
+        if (!entry) {
+            if (registry.count < PEER_REGISTRY_LEN) {
+                entry = &registry.entries[registry.count++];
+            } else {
+                // registry full, the least recently used peer is forgotten
+                entry = find_lru_(false);
+                if (!entry) {
+                    return nullptr;
+                }
+                unregister_peer_(entry);
+                registry.evictions++;
+            }
+            *entry = peer_registry_entry_t{addr_to_addr64(peer), 0, channel, ifidx, false};
+        } else if (entry->channel != channel || entry->ifidx != ifidx) {
+            unregister_peer_(entry);
+            entry->channel = channel;
+            entry->ifidx = ifidx;
+        }
+        return entry;
+    }
+
+    bool add_peer(const uint8_t *peer, int channel, int netif) {
+        if (!is_ready()) {
+            return false;
+        }
+        ESP_LOGD(TAG, "Adding peer %s", mac_str(peer).c_str());
+        return register_peer_(insert_peer_(peer, static_cast<uint8_t>(channel), static_cast<uint8_t>(netif)));
     }
 
     bool has_peer(const uint8_t *peer) {
-        return is_ready() && esp_now_is_peer_exist(peer);
+        return is_ready() && find_peer_(peer);
     }
 
     bool remove_peer(const uint8_t *peer) {
-        return is_ready() && esp_now_del_peer(peer) == ESP_OK;
+        peer_registry_entry_t *entry = find_peer_(peer);
+        if (!is_ready() || !entry) {
+            return false;
+        }
+        unregister_peer_(entry);
+        peer_registry_t &registry = registry_();
+        *entry = registry.entries[--registry.count];
+        return true;
     }
 
-    int list_peers(esp_now_peer_info_t* peers, int max_peers) {
+    // peers known, registered with the radio or not
+    int list_peers(radio_peer_t *peers, int max_peers) {
         if (!is_ready()) {
             return 0;
         }
-        int total = 0;
-        esp_now_peer_info_t peer;
-        for (
-            esp_err_t e = esp_now_fetch_peer(true, &peer);
-            e == ESP_OK;
-            e = esp_now_fetch_peer(false, &peer)
-        ) {
-            uint8_t* mac = peer.peer_addr;
-            uint8_t channel = peer.channel;
-            if (total < max_peers) {
-                memcpy(&peers[total], &peer, sizeof(esp_now_peer_info_t));
-            }
-            ++total;
+        peer_registry_t &registry = registry_();
+        for (auto i = 0; i < registry.count && i < max_peers; i++) {
+            memcpy(peers[i].addr, addr64_to_addr(registry.entries[i].address), MAC_ADDRESS_LEN);
+            peers[i].channel = registry.entries[i].channel;
+            peers[i].ifidx = registry.entries[i].ifidx;
         }
-        return total;
+        return registry.count;
+    }
+
+    const peer_registry_t *get_peer_registry() {
+        return &registry_();
     }
 
     // public functions
@@ -101,6 +197,7 @@ namespace espnow_proxy_base {
         if (send_callback_idx_ == MAX_CALLBACKS - 1) {
             return false;
         }
+        send_callback_nodes_[send_callback_idx_] = radio_node();
         send_callbacks_[send_callback_idx_++] = callback;
         return true;
     }
@@ -109,26 +206,82 @@ namespace espnow_proxy_base {
         if (recv_callback_idx_ == MAX_CALLBACKS - 1) {
             return false;
         }
+        recv_callback_nodes_[recv_callback_idx_] = radio_node();
         recv_callbacks_[recv_callback_idx_++] = callback;
         return true;
     }
 
-    bool send(uint8_t *dest, uint8_t *data, size_t size) {
-        ESP_LOGD(TAG, "Send handler begin: %s", addr_to_str(dest).c_str());
-        set_sending_(true);
-        set_send_time_(micros());
-        set_success_(false);
+    // frames
+
+    tx_frame_t *alloc_frame() {
+        for (auto &frame : frames_[radio_node()]) {
+            uint8_t expected = Frame_Free;
+            if (frame.state.compare_exchange_strong(expected, Frame_Filling, std::memory_order_acquire)) {
+                return &frame;
+            }
+        }
+        // a completion that never arrived must not hold a frame forever
+        tx_frame_t *oldest = oldest_in_flight_();
+        uint8_t expected = Frame_InFlight;
+        if (
+            oldest && clock_micros() - oldest->send_time > SEND_TIMEOUT_MS * 1000 &&
+            oldest->state.compare_exchange_strong(expected, Frame_Filling, std::memory_order_acquire)
+        ) {
+            return oldest;
+        }
+        state_().frames_exhausted++;
+        return nullptr;
+    }
 
-        if (!has_peer(dest) && !add_peer(dest, 0, 0)) {
-            ESP_LOGW(TAG, "Unknown peer: %s", addr_to_str(dest).c_str());
+    void release_frame(tx_frame_t *frame) {
+        if (frame) {
+            frame->state.store(Frame_Free, std::memory_order_release);
         }
-        if (esp_now_send(dest, data, size) == ESP_OK) {
-            set_success_(true);
+    }
+
+    // oldest frame in flight, only to dest if set
+    tx_frame_t *oldest_in_flight_(const uint8_t *dest) {
+        tx_frame_t *oldest = nullptr;
+        for (auto &frame : frames_[radio_node()]) {
+            if (
+                frame.state.load(std::memory_order_acquire) == Frame_InFlight &&
+                (!dest || memcmp(frame.dest, dest, MAC_ADDRESS_LEN) == 0) &&
+                (!oldest || (int32_t)(frame.seq - oldest->seq) < 0)
+            ) {
+                oldest = &frame;
+            }
+        }
+        return oldest;
+    }
+
+    bool send_frame(const uint8_t *dest, tx_frame_t *frame, size_t size) {
+        PACKET_LOGD(TAG, "Send frame to %s (%zu bytes)", mac_str(dest).c_str(), size);
+
+        peer_registry_entry_t *entry = find_peer_(dest);
+        if (!register_peer_(entry ? entry : insert_peer_(dest, 0, RADIO_IF_STA))) {
+            ESP_LOGW(TAG, "Could not register peer: %s", mac_str(dest).c_str());
+        }
+
+        // in flight before sending, the completion may arrive before radio_send returns
+        frame->seq = frame_seq_++;
+        frame->send_time = clock_micros();
+        memcpy(frame->dest, dest, MAC_ADDRESS_LEN);
+        frame->state.store(Frame_InFlight, std::memory_order_release);
+        if (!radio_send(dest, frame->data.raw, size)) {
+            release_frame(frame);
+            return false;
         }
+        return true;
+    }
 
-        ESP_LOGD(TAG, "Send handler finished: %d", is_success());
-        set_sending_(false);
-        return is_success();
+    bool send(uint8_t *dest, uint8_t *data, size_t size) {
+        tx_frame_t *frame = alloc_frame();
+        if (!frame || size > MAX_DATA_LEN) {
+            release_frame(frame);
+            return false;
+        }
+        memcpy(frame->data.raw, data, size);
+        return send_frame(dest, frame, size);
     }
 
     void begin() {
@@ -136,15 +289,22 @@ namespace espnow_proxy_base {
             end();
         }
 
-        ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-        state_.is_ready = false;
-        if (esp_now_init() == ESP_OK) {
+        state_().is_ready = false;
+        if (radio_init(send_handler, recv_handler)) {
             ESP_LOGD(TAG, "Begin: init done");
-            ESP_ERROR_CHECK(esp_now_register_send_cb(send_handler));
-            ESP_ERROR_CHECK(esp_now_register_recv_cb(recv_handler));
-            state_.is_ready = true;
+            state_().is_ready = true;
+            // radio peer table starts empty, known peers register again on use
+            peer_registry_t &registry = registry_();
+            for (auto i = 0; i < registry.count; i++) {
+                registry.entries[i].registered = false;
+            }
+            registry.registered = 0;
+            // no completions are pending after an init
+            for (auto &frame : frames_[radio_node()]) {
+                release_frame(&frame);
+            }
         } else {
-            ESP_LOGW(TAG, "Begin: esp_now_init failed");
+            ESP_LOGW(TAG, "Begin: radio init failed");
             deinit();
             begin();
         }
@@ -152,12 +312,8 @@ namespace espnow_proxy_base {
     }
 
     void deinit() {
-        ESP_LOGD(TAG, "End: unregister recv cb call");
-        esp_now_unregister_recv_cb();
-        ESP_LOGD(TAG, "base setup_wifi: unregister send cb call");
-        esp_now_unregister_send_cb();
         ESP_LOGD(TAG, "End: deinit call");
-        esp_now_deinit();
+        radio_deinit();
     }
 
     void end() {
@@ -165,60 +321,64 @@ namespace espnow_proxy_base {
             return;
         }
         deinit();
-        state_.is_ready = false;
+        state_().is_ready = false;
         ESP_LOGD(TAG, "End: finished");
     }
 
     // status
 
     bool is_success() {
-        return state_.is_success;
+        return state_().is_success;
     }
 
     bool is_ready() {
-        return state_.is_ready;
+        return state_().is_ready;
     }
 
     bool is_sending() {
-        return state_.is_sending;
+        return oldest_in_flight_() != nullptr;
     }
 
     uint8_t *sender() {
-        return state_.sender;
+        return state_().sender;
     }
 
     State get_state() {
-        return state_;
+        return state_();
     }
 
     // callbacks
 
-    void send_handler(const uint8_t *addr, esp_now_send_status_t status) {
-        if (status == ESP_NOW_SEND_SUCCESS) {
+    void send_handler(const uint8_t *addr, uint8_t status) {
+        if (status == Radio_SendSuccess) {
             set_success_(true);
             inc_sent_();
         } else {
             set_success_(false);
             inc_sent_error_();
         }
-        state_.duration = calc_duration_(state_.send_time);
-        set_sending_(false);
-        // run callbacks
+        // completion of the oldest frame of this node to the address, none
+        // if the frame was reclaimed after the send timeout
+        tx_frame_t *frame = oldest_in_flight_(addr);
+        if (frame) {
+            state_().duration = calc_duration_(frame->send_time);
+        }
+        // run callbacks of the node sending, the frame is still owned
         for (auto i = 0; i < send_callback_idx_; i++) {
-            if (send_callbacks_[i]) {
-                send_callbacks_[i](addr, status);
+            if (send_callbacks_[i] && send_callback_nodes_[i] == radio_node()) {
+                send_callbacks_[i](addr, status, frame ? &frame->data : nullptr);
             }
         }
+        release_frame(frame);
     }
 
-    void recv_handler(const esp_now_recv_info_t *recv_info, const uint8_t *data, int size) {
-        // addr may be different then base address, see the link below for details.
-        // https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/misc_system_api.html
-        set_sender_((uint8_t *)recv_info->src_addr);
+    void recv_handler(const uint8_t *addr, const uint8_t *data, int size) {
+        set_sender_((uint8_t *)addr);
         inc_received_();
+        // run callbacks of the node receiving
         for (auto i = 0; i < recv_callback_idx_; i++) {
-            if (recv_callbacks_[i]) {
-                recv_callbacks_[i](recv_info->src_addr, data, size);
+            if (recv_callbacks_[i] && recv_callback_nodes_[i] == radio_node()) {
+                recv_callbacks_[i](addr, data, size);
             }
         }
     }
@@ -1,61 +1,110 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 
 #include "esphome/core/log.h"
 
-#include <esp_wifi.h>
-#include <esp_now.h>
-#include <esp_log.h>
-
-#include <Arduino.h>
-
 #include "common.h"
+#include "radio.h"
 #include "send.h"
 
 namespace esphome {
 namespace espnow_proxy_base {
 
     //using command_callback_t = std::function<void(const uint8_t, const uint8_t *, const int)>;
-    using send_callback_t = std::function<void(const uint8_t *, esp_now_send_status_t)>;
+    // the completed frame, nullptr if the completion matched no frame in flight
+    using send_callback_t = std::function<void(const uint8_t *, uint8_t, const packet_data_t *)>;
     using recv_callback_t = std::function<void(const uint8_t *, const uint8_t *, int)>;
 
     struct State {
         bool is_ready = false;
-        bool is_sending = false;
-        bool is_success = false;
+        bool is_success = false;  // status of the last completed frame
         uint32_t sent_error = 0;
         uint32_t sent = 0;
         uint32_t received = 0;
-        uint32_t send_time = 0;
-        uint16_t duration = 0;
+        uint32_t frames_exhausted = 0;  // sends without a free frame
+        uint16_t duration = 0;  // us of the last completed frame
         uint8_t *sender = nullptr;
     };
 
+    // Transmit frames, owned from building the frame until the radio reports
+    // its completion. The radio completes frames in the order they were
+    // sent, a completion is matched to the oldest frame in flight to its
+    // address, so a frame reclaimed without completion does not shift the
+    // others. Frames are taken and returned lock free, the completion runs
+    // on the wifi task. A full transmit window is sent in one pass, the
+    // reserve covers acks and responses built at the same time.
+    #ifndef TX_FRAME_RESERVE
+    #define TX_FRAME_RESERVE 4
+    #endif
+    #ifndef TX_FRAME_POOL_LEN
+    #define TX_FRAME_POOL_LEN (MAX_WINDOW_SIZE + TX_FRAME_RESERVE)
+    #endif
+
+    typedef enum {
+        Frame_Free = 0x00,
+        Frame_Filling = 0x01,
+        Frame_InFlight = 0x02,
+    } Frame_e;
+
+    struct tx_frame_t {
+        std::atomic<uint8_t> state{Frame_Free};
+        uint32_t seq;  // submit order
+        uint32_t send_time;
+        uint8_t dest[MAC_ADDRESS_LEN];
+        packet_data_t data;
+    };
+
+    // software peer registry, registered with the radio on use and evicted
+    // least recently used first when the radio peer table is full
+    struct peer_registry_entry_t {
+        mac_address_t address;
+        uint32_t last_used;
+        uint8_t channel;
+        uint8_t ifidx;
+        bool registered;  // currently in the radio peer table
+    };
+
+    struct peer_registry_t {
+        peer_registry_entry_t entries[PEER_REGISTRY_LEN];
+        uint8_t count = 0;
+        uint8_t registered = 0;
+        uint32_t clock = 0;  // use counter for the lru order
+        uint32_t hits = 0;  // destination already registered with the radio
+        uint32_t misses = 0;
+        uint32_t evictions = 0;
+    };
+
     static const uint8_t BROADCAST[MAC_ADDRESS_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
     // Function prototypes
     bool send(uint8_t *dest, uint8_t *data, size_t size);
+    tx_frame_t *alloc_frame();
+    void release_frame(tx_frame_t *frame);
+    // hands the frame to the radio, it is released on completion or failure
+    bool send_frame(const uint8_t *dest, tx_frame_t *frame, size_t size);
     void begin();
     void end();
     void deinit();
     bool add_send_callback(send_callback_t callback);
     bool add_recv_callback(recv_callback_t callback);
 
-    bool add_peer(const uint8_t *peer, int channel=0, int netif=ESP_IF_WIFI_STA);
+    bool add_peer(const uint8_t *peer, int channel=0, int netif=RADIO_IF_STA);
     bool has_peer(const uint8_t *peer);
     bool remove_peer(const uint8_t *peer);
-    int list_peers(esp_now_peer_info_t* peers, int max_peers);
+    int list_peers(radio_peer_t *peers, int max_peers);
+    const peer_registry_t *get_peer_registry();
 
     uint8_t *sender();
     bool is_success();
     bool is_ready();
-    bool is_sending();
+    bool is_sending();  // frames in flight
     State get_state();
 
     // Callback function prototypes
-    void send_handler(const uint8_t *addr, esp_now_send_status_t status);
-    void recv_handler(const esp_now_recv_info_t *recv_info, const uint8_t *data, int size);
+    void send_handler(const uint8_t *addr, uint8_t status);
+    void recv_handler(const uint8_t *addr, const uint8_t *data, int size);
 
 }  // namespace espnow_proxy_base
 }  // esphome
\ No newline at end of file
@@ -1,8 +1,145 @@
+#include <algorithm>
+
 #include "common.h"
 
 namespace esphome {
 namespace espnow_proxy_base {
 
+    Seq_e seq_window_check(seq_window_t *window, uint16_t packet_id, bool mark) {
+
+        int16_t diff = (int16_t)(packet_id - window->highest);
+
+        // first packet, or too far behind to be a retransmission (sender restarted)
+        if (!window->valid || diff <= -SEQ_WINDOW_LEN) {
+            if (mark) {
+                window->valid = true;
+                window->highest = packet_id;
+                window->bitmap = 1;
+            }
+            return Seq_New;
+        }
+
+        // newer than anything seen so far, slide window
+        if (diff > 0) {
+            if (mark) {
+                window->bitmap = diff >= SEQ_WINDOW_LEN ? 1 : (window->bitmap << diff) | 1;
+                window->highest = packet_id;
+            }
+            return Seq_New;
+        }
+
+        // inside window, check if already received
+        uint32_t bit = 1UL << (-diff);
+        if (window->bitmap & bit) {
+            return Seq_Duplicate;
+        }
+        if (mark) {
+            window->bitmap |= bit;
+        }
+        return Seq_OutOfOrder;
+
+    }
+
+    void seq_window_to_sack(const seq_window_t *window, uint16_t *packet_id_acked, uint32_t *sack_bitmap) {
+
+        // everything older than the window counts as received, the sender never
+        // has packets in flight that are further apart than the window
+        int gap = SEQ_WINDOW_LEN - 1;
+        while (gap >= 0 && (window->bitmap & (1UL << gap))) {
+            gap--;
+        }
+        *packet_id_acked = window->highest - gap - 1;
+
+        // received packets after the first gap, bit 0 is the gap itself
+        *sack_bitmap = 0;
+        for (int n = gap - 1, bit = 1; n >= 0; n--, bit++) {
+            if (window->bitmap & (1UL << n)) {
+                *sack_bitmap |= 1UL << bit;
+            }
+        }
+
+    }
+
+    bool sack_covers(uint16_t packet_id_acked, uint32_t sack_bitmap, uint16_t packet_id) {
+
+        int16_t diff = (int16_t)(packet_id - packet_id_acked);
+        if (diff <= 0) {
+            return true;
+        }
+        return diff <= SEQ_WINDOW_LEN && (sack_bitmap & (1UL << (diff - 1)));
+
+    }
+
+    uint32_t seq_window_missing(const seq_window_t *window) {
+
+        // gaps between the oldest packet seen in the window and the highest,
+        // older ids may never have been sent to this receiver
+        uint32_t missing = 0;
+        int oldest = SEQ_WINDOW_LEN - 1;
+        while (oldest > 0 && !(window->bitmap & (1UL << oldest))) {
+            oldest--;
+        }
+        for (int n = 1; n < oldest; n++) {
+            if (!(window->bitmap & (1UL << n))) {
+                missing |= 1UL << (n - 1);
+            }
+        }
+        return missing;
+
+    }
+
+    bool nack_covers(uint16_t packet_id_highest, uint32_t nack_bitmap, uint16_t packet_id) {
+
+        int16_t diff = (int16_t)(packet_id_highest - packet_id);
+        return diff > 0 && diff <= SEQ_WINDOW_LEN && (nack_bitmap & (1UL << (diff - 1)));
+
+    }
+
+    void histogram_add(uint32_t *histogram, uint32_t value) {
+
+        uint8_t bucket = value ? 32 - __builtin_clz(value) : 0;
+        histogram[std::min(bucket, (uint8_t)(HISTOGRAM_LEN - 1))]++;
+
+    }
+
+    uint32_t histogram_percentile(const uint32_t *histogram, uint8_t percent) {
+
+        // upper bound of the bucket the percentile falls into, in ms
+        uint64_t total = 0;
+        for (int n = 0; n < HISTOGRAM_LEN; n++) {
+            total += histogram[n];
+        }
+        if (!total) {
+            return 0;
+        }
+        uint64_t count = 0;
+        for (int n = 0; n < HISTOGRAM_LEN; n++) {
+            count += histogram[n];
+            if (count * 100 >= total * percent) {
+                return 1UL << n;
+            }
+        }
+        return 1UL << (HISTOGRAM_LEN - 1);
+
+    }
+
+    void rtt_sample(rtt_estimator_t *rtt, uint32_t sample, uint32_t min_rto, uint32_t max_rto) {
+
+        if (!rtt->valid) {
+            rtt->valid = true;
+            rtt->srtt8 = sample << 3;
+            rtt->rttvar4 = sample << 1;
+        } else {
+            int32_t delta = (int32_t)sample - (int32_t)(rtt->srtt8 >> 3);
+            rtt->srtt8 += delta;
+            rtt->rttvar4 += (delta < 0 ? -delta : delta) - (rtt->rttvar4 >> 2);
+        }
+
+        uint32_t rto = (rtt->srtt8 >> 3) + std::max(rtt->rttvar4, (uint32_t)1);
+        rtt->rto = std::min(std::max(rto, min_rto), max_rto);
+
+    }
+
     mac_address_t addr_to_addr64(const uint8_t *address) {
         uint64_t temp = (uint64_t(address[0]) << 40) |
                         (uint64_t(address[1]) << 32) |
@@ -25,31 +162,32 @@ namespace espnow_proxy_base {
     }
 
     std::string addr64_to_str(mac_address_t address) {
-        char buffer[18];
-        snprintf(
-            buffer,
-            sizeof(buffer),
-            "%02x:%02x:%02x:%02x:%02x:%02x",
-            (uint8_t)(address >> 40) & 0xff,
-            (uint8_t)(address >> 32) & 0xff,
-            (uint8_t)(address >> 24) & 0xff,
-            (uint8_t)(address >> 16) & 0xff,
-            (uint8_t)(address >> 8) & 0xff,
-            (uint8_t)(address >> 0) & 0xff);
-        return buffer;
+        return mac_str(address).c_str();
     }
 
     std::string addr_to_str(const uint8_t *address) {
-        char buffer[18];
-        snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
-                    (uint8_t)address[0],
-                    (uint8_t)address[1],
-                    (uint8_t)address[2],
-                    (uint8_t)address[3],
-                    (uint8_t)address[4],
-                    (uint8_t)address[5]);
-        return buffer;
+        return mac_str(address).c_str();
     };
 
+    mac_str_t mac_str(const uint8_t *address) {
+        static const char HEX[] = "0123456789abcdef";
+        mac_str_t result;
+        char *out = result.buffer;
+        for (auto i = 0; i < MAC_ADDRESS_LEN; i++) {
+            *out++ = HEX[address[i] >> 4];
+            *out++ = HEX[address[i] & 0x0F];
+            *out++ = i < MAC_ADDRESS_LEN - 1 ? ':' : '\0';
+        }
+        return result;
+    }
+
+    mac_str_t mac_str(mac_address_t address) {
+        uint8_t buffer[MAC_ADDRESS_LEN];
+        for (auto i = 0; i < MAC_ADDRESS_LEN; i++) {
+            buffer[i] = (address >> (8 * (MAC_ADDRESS_LEN - 1 - i))) & 0xFF;
+        }
+        return mac_str(buffer);
+    }
+
 }  // namespace espnow_proxy_base
 }  // esphome
\ No newline at end of file
@@ -1,13 +1,62 @@
 #pragma once
 
 #include <cstring>
+#include <functional>
 #include <string>
 
+#include "esphome/core/defines.h"
+
 namespace esphome {
 namespace espnow_proxy_base {
 
-    #define MAX_CALLBACKS 5
+    // radio nodes in this process, more than one only in the host simulation
+    #ifndef RADIO_NODE_LEN
+    #ifdef USE_HOST
+    #define RADIO_NODE_LEN 8
+    #else
+    #define RADIO_NODE_LEN 1
+    #endif
+    #endif
+
+    #define MAX_CALLBACKS (5 * RADIO_NODE_LEN)
     #define MAX_PEERS 10
+    // unacked messages in flight per link
+    #define MAX_WINDOW_SIZE 16
+
+    // peers known in software, only the most recently used ones are
+    // registered with the radio (ESP_NOW_MAX_TOTAL_PEER_NUM)
+    #ifndef PEER_REGISTRY_LEN
+    #define PEER_REGISTRY_LEN 64
+    #endif
+    #ifndef RADIO_PEER_LEN
+    #define RADIO_PEER_LEN 20
+    #endif
+
+    // pool capacities, overridden from yaml (send_pool_size / recv_pool_size)
+    #ifndef SEND_POOL_LEN
+    #define SEND_POOL_LEN 8
+    #endif
+    #ifndef RECV_QUEUE_LEN
+    #define RECV_QUEUE_LEN 16
+    #endif
+    // delivery status of recent sends, a power of two holding every message
+    // in the send pool twice (completed ones wait for the next loop)
+    #ifndef DELIVERY_LEN
+    #define DELIVERY_LEN 32
+    #endif
+
+    // fragmentation, overridden from yaml (max_message_size / reassembly_slots)
+    #ifndef MAX_MESSAGE_LEN
+    #define MAX_MESSAGE_LEN 4096
+    #endif
+    #ifndef FRAGMENT_POOL_LEN
+    #define FRAGMENT_POOL_LEN 4
+    #endif
+
+    // protocol task, overridden from yaml (event_queue_size)
+    #ifndef EVENT_QUEUE_LEN
+    #define EVENT_QUEUE_LEN 16
+    #endif
 
     #define MAC_ADDRESS_LEN 6
     #define MAGIC_HEADER_LEN 2
@@ -15,6 +64,9 @@ namespace espnow_proxy_base {
     #define SEND_TIMEOUT_MS 2500L
     #define HEADER_LEN (sizeof(command_header_t))
     #define MAX_PAYLOAD_LENGTH (MAX_DATA_LEN - HEADER_LEN)
+    #define FRAGMENT_HEADER_LEN (sizeof(fragment_header_t))
+    #define MAX_FRAGMENT_LEN (MAX_PAYLOAD_LENGTH - FRAGMENT_HEADER_LEN)
+    #define BATCH_RECORD_HEADER_LEN 1
 
     typedef uint64_t mac_address_t;
 
@@ -22,12 +74,30 @@ namespace espnow_proxy_base {
         Command_None = 0x00,
         Command_Data = 0x01,
         Command_DataAck = 0x02,
+        Command_DataSack = 0x03,
+        Command_Fragment = 0x04,
+        Command_Batch = 0x05,
+        Command_DataNack = 0x06,
+        Command_Request = 0x07,
+        Command_Response = 0x08,
     } Command_e;
 
+    // flags in the upper bits of the command byte
+    #define COMMAND_MASK 0x0F
+    #define COMMAND_FLAG_MASK 0xC0
+    #define COMMAND_FLAG_NO_ACK 0x80  // receivers do not ack, used for broadcast
+    #define COMMAND_FLAG_NACK 0x40  // receivers report missing packets instead
+    // without NO_ACK: the frame is from the shared sequence space of the
+    // sender, on acks: the ack covers that space
+    #define COMMAND_FLAG_SHARED 0x40
+    // send priority of the frame, an overloaded receiver drops bulk first
+    #define COMMAND_PRIORITY_MASK 0x30
+    #define COMMAND_PRIORITY_SHIFT 4
+
     typedef struct __attribute__((packed)) {
         uint8_t magic[MAGIC_HEADER_LEN];
         uint8_t command;
-        uint8_t packet_id;
+        uint16_t packet_id;
     } command_header_t;
 
     typedef struct __attribute__((packed)) {
@@ -37,16 +107,62 @@ namespace espnow_proxy_base {
 
     typedef struct __attribute__((packed)) {
         command_header_t header;
-        uint8_t packet_id_acked;
+        uint16_t packet_id_acked;
     } command_data_ack_t;
 
+    typedef struct __attribute__((packed)) {
+        uint16_t message_id;
+        uint16_t offset;
+        uint16_t total_len;
+    } fragment_header_t;
+
+    typedef struct __attribute__((packed)) {
+        command_header_t header;
+        fragment_header_t fragment;
+        uint8_t data[MAX_FRAGMENT_LEN];
+    } command_fragment_t;
+
+    // payload of Command_Batch is a list of records, each one a length byte
+    // followed by the data of a single command
+
+    // cumulative ack: every packet up to packet_id_acked was received,
+    // bit n of sack_bitmap set: packet (packet_id_acked + 1 + n) was received
+    typedef struct __attribute__((packed)) {
+        command_header_t header;
+        uint16_t packet_id_acked;
+        uint32_t sack_bitmap;
+        uint8_t credit;  // frames the receiver takes before it drops
+    } command_data_sack_t;
+
+    // no credit advertised (flow control off), only the window applies
+    #define CREDIT_UNKNOWN 0xFF
+
+    // sent to a broadcasting sender on gaps,
+    // bit n of nack_bitmap set: packet (packet_id_highest - 1 - n) is missing
+    typedef struct __attribute__((packed)) {
+        command_header_t header;
+        uint16_t packet_id_highest;
+        uint32_t nack_bitmap;
+    } command_data_nack_t;
+
     typedef union __attribute__((packed)) {
         uint8_t raw[MAX_DATA_LEN];
         command_header_t command_header;
         command_data_t command_data;
         command_data_ack_t command_data_ack;
+        command_data_sack_t command_data_sack;
+        command_data_nack_t command_data_nack;
+        command_fragment_t command_fragment;
     } packet_data_t;
 
+    // what is dropped once the receive queue is above its limit
+    typedef enum {
+        RecvDrop_Newest = 0x00,  // incoming frames
+        RecvDrop_Oldest = 0x01,  // frames waiting longest
+        RecvDrop_Priority = 0x02,  // lowest send priority first, then oldest
+    } RecvDrop_e;
+
+    // size 0: dropped from the queue, skipped when taken
     struct recv_data_t {
         uint32_t time;
         uint8_t addr[MAC_ADDRESS_LEN];
@@ -54,20 +170,161 @@ namespace espnow_proxy_base {
         size_t size;
     };
 
+    // send priority classes, lower value is served first
+    typedef enum {
+        Priority_Control = 0x00,
+        Priority_Telemetry = 0x01,
+        Priority_Bulk = 0x02,
+    } Priority_e;
+
+    #define PRIORITY_LEN 3
+
+    // reliability of messages sent to the broadcast address
+    typedef enum {
+        BroadcastMode_Ack = 0x00,  // every receiver acks
+        BroadcastMode_Unacked = 0x01,  // sent once, no acks
+        BroadcastMode_Nack = 0x02,  // receivers only report gaps
+    } BroadcastMode_e;
+
+    // outcome of a sent message
+    typedef enum {
+        Delivery_Pending = 0x00,
+        Delivery_Acked = 0x01,
+        Delivery_Sent = 0x02,  // no ack expected (unacked / nack broadcast)
+        Delivery_Timeout = 0x03,  // retries or time exhausted
+        Delivery_Dropped = 0x04,  // not queued or cancelled
+        Delivery_Unknown = 0x05,  // handle older than the delivery table
+        Delivery_Replaced = 0x06,  // superseded by a newer message with the same key
+    } Delivery_e;
+
+    // identifies one sent message, id 0 if the message was not queued
+    struct delivery_handle_t {
+        uint32_t id = 0;
+        explicit operator bool() const { return id != 0; }
+    };
+
+    // called once from the main loop with the final status
+    typedef std::function<void(delivery_handle_t, uint8_t)> delivery_callback_t;
+
+    struct send_options_t {
+        mac_address_t address = 0;  // 0: configured receiver or broadcast
+        uint8_t priority = Priority_Telemetry;
+        delivery_callback_t on_delivery = nullptr;
+        // 0: no key. a newer message with the same key and address replaces
+        // this one until it was acked, only the latest value is sent
+        uint8_t key = 0;
+    };
+
     struct send_data_t {
-        uint8_t packet_id;
+        uint8_t command;
+        uint8_t flags;
+        uint8_t priority;
+        uint16_t packet_id;
+        uint32_t queue_time;
         uint32_t time;
+        uint32_t tx_time;
+        uint32_t rto;
         uint8_t retries;
         mac_address_t address;
         uint8_t data[MAX_PAYLOAD_LENGTH];
         size_t size;
         bool sent;
+        uint32_t delivery;  // handle id, 0 if not tracked
+        uint8_t key;
+        bool replaced;  // a newer value with the key is queued, no more retries
+        send_data_t *batch;  // leader of the frame this message is packed into
+    };
+
+    // receive side duplicate suppression, one window per peer and sequence space
+    #define SEQ_WINDOW_LEN 32
+
+    // sequence spaces of a sender: one per configured peer, one shared by
+    // broadcasts and all other destinations
+    typedef enum {
+        Space_Peer = 0x00,
+        Space_Shared = 0x01,
+    } Space_e;
+
+    #define SPACE_LEN 2
+
+    typedef enum {
+        Seq_New = 0x00,
+        Seq_OutOfOrder = 0x01,
+        Seq_Duplicate = 0x02,
+    } Seq_e;
+
+    struct seq_window_t {
+        bool valid = false;
+        uint16_t highest = 0;
+        uint32_t bitmap = 0;  // bit n set: packet (highest - n) was received
     };
 
+    Seq_e seq_window_check(seq_window_t *window, uint16_t packet_id, bool mark=true);
+    void seq_window_to_sack(const seq_window_t *window, uint16_t *packet_id_acked, uint32_t *sack_bitmap);
+    bool sack_covers(uint16_t packet_id_acked, uint32_t sack_bitmap, uint16_t packet_id);
+    uint32_t seq_window_missing(const seq_window_t *window);
+    bool nack_covers(uint16_t packet_id_highest, uint32_t nack_bitmap, uint16_t packet_id);
+
+    // retransmit timeout from measured round trip times (rfc 6298), values
+    // in ms, smoothed rtt scaled by 8 and rtt variance scaled by 4
+    #define RTO_BACKOFF_MAX_SHIFT 6
+
+    struct rtt_estimator_t {
+        bool valid = false;
+        uint32_t srtt8 = 0;
+        uint32_t rttvar4 = 0;
+        uint32_t rto = 0;
+    };
+
+    void rtt_sample(rtt_estimator_t *rtt, uint32_t sample, uint32_t min_rto, uint32_t max_rto);
+
+    // per link statistics, only integer increments on the hot path. bucket n
+    // of a histogram counts values below 2^n ms, the last one everything above
+    #define HISTOGRAM_LEN 12
+
+    struct link_stats_t {
+        uint32_t delivered = 0;  // sent messages acked
+        uint32_t retransmits = 0;
+        uint32_t send_failed = 0;  // frames the radio reported as not delivered
+        uint32_t timeouts = 0;  // sent messages given up
+        uint32_t dropped = 0;  // messages not queued
+        uint32_t replaced = 0;  // keyed messages superseded by a newer value
+        uint32_t received = 0;
+        uint32_t duplicates = 0;
+        uint32_t out_of_order = 0;
+        uint32_t queue_high_water = 0;
+        uint32_t rtt[HISTOGRAM_LEN] = {};  // send to ack of first attempts
+        uint32_t latency[HISTOGRAM_LEN] = {};  // queued to acked
+    };
+
+    void histogram_add(uint32_t *histogram, uint32_t value);
+    uint32_t histogram_percentile(const uint32_t *histogram, uint8_t percent);
+
     std::string addr64_to_str(mac_address_t address);
     uint8_t *addr64_to_addr(mac_address_t address);
     std::string addr_to_str(const uint8_t *address);
     mac_address_t addr_to_addr64(const uint8_t *address);
 
+    // formatted address in a stack buffer, no heap usage. the temporary lives
+    // until the end of the statement: ESP_LOGD(TAG, "%s", mac_str(addr).c_str())
+    #define MAC_STR_LEN 18
+
+    struct mac_str_t {
+        char buffer[MAC_STR_LEN];
+        const char *c_str() const { return buffer; }
+    };
+
+    mac_str_t mac_str(const uint8_t *address);
+    mac_str_t mac_str(mac_address_t address);
+
+    // logs on the packet path, only compiled in with packet_log: true. without
+    // it the arguments are not evaluated, even if the log level would allow it.
+    // the tag is still referenced, it may be used by packet logs only
+    #ifdef USE_ESPNOW_PROXY_PACKET_LOG
+    #define PACKET_LOGD(tag, ...) ESP_LOGD(tag, __VA_ARGS__)
+    #else
+    #define PACKET_LOGD(tag, ...) do { (void)(tag); } while (0)
+    #endif
+
 }  // namespace espnow_proxy_base
 }  // esphome
\ No newline at end of file
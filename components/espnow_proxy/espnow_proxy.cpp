@@ -38,285 +38,2139 @@ namespace espnow_proxy {
     }
 
     ESPNowProxyPeer *ESPNowProxy::get_peer_by_mac_address_(const mac_address_t address) {
-        ESP_LOGD(TAG, "looking for address %s", addr64_to_str(address).c_str());
-        // address match
-        if (peers_.find(address) != peers_.end()) {
-            return peers_[address];
-        }
-        // softap address match
-        uint8_t *base_address = addr64_to_addr(address);
-        base_address[MAC_ADDRESS_LEN-1]--;
-        mac_address_t temp_address = addr_to_addr64(base_address);
-        if (peers_.find(temp_address) != peers_.end()) {
+
+        // station or softap address match, one probe for configured peers
+        auto entry = peer_table_.find(address);
+        if (!entry) {
+            return nullptr;
+        }
+        if (entry->alias && !entry->registered) {
             if (!espnow_proxy_base::has_peer(addr64_to_addr(address))) {
-                ESP_LOGW(TAG, "Adding softAP peer %s", addr64_to_str(address).c_str());
+                ESP_LOGW(TAG, "Adding softAP peer %s", mac_str(address).c_str());
                 espnow_proxy_base::add_peer(addr64_to_addr(address));
             }
-            return peers_[temp_address];
+            entry->registered = true;
+            persist_dirty_ = persist_;
+        }
+        return entry->value;
+
+    }
+
+    ESPNowProxyBase *ESPNowProxy::get_link_(const mac_address_t address) {
+
+        // configured peers keep their own sequence space, everything else
+        // (receiver, broadcast) uses the one of the proxy
+        auto entry = peer_table_.find(address);
+        if (entry && !entry->alias) {
+            return entry->value;
+        }
+        return this;
+
+    }
+
+    mac_address_t ESPNowProxy::get_send_address_() {
+
+        if (address_) {
+            return address_;
+        }
+        return addr_to_addr64(espnow_proxy_base::BROADCAST);
+
+    }
+
+    // callback handler
+
+    void ESPNowProxy::on_send_(const uint8_t *addr, uint8_t status, const packet_data_t *frame) {
+
+        // runs on the wifi task, failed sequenced frames are handed to the
+        // protocol. acks and unacked broadcasts are not retried
+        PACKET_LOGD(TAG, "Message send status %d", status);
+        if (status == Radio_SendSuccess || !frame) {
+            return;
+        }
+        uint8_t command = frame->command_header.command;
+        switch (command & COMMAND_MASK) {
+            case Command_Data:
+            case Command_Fragment:
+            case Command_Batch:
+            case Command_Request:
+            case Command_Response:
+                break;
+            default:
+                return;
+        }
+        if (command & COMMAND_FLAG_NO_ACK) {
+            return;
+        }
+        send_status_t *failed = send_status_.acquire();
+        if (!failed) {
+            return;
+        }
+        failed->address = addr_to_addr64(addr);
+        failed->command = command;
+        failed->packet_id = frame->command_header.packet_id;
+        send_status_.commit();
+        wake_();
+
+    }
+
+    void ESPNowProxy::on_recv_(const uint8_t *addr, const uint8_t *data, int size) {
+
+        if (size <= 0 || size > MAX_DATA_LEN) {
+            return;
+        }
+
+        // write received data in place into the next free slot, runs on the wifi task.
+        // above the limit frames are only taken if queued ones are dropped instead
+        recv_data_t *received = recv_queue_.acquire(recv_drop_policy_ == RecvDrop_Newest ? recv_limit_ : RECV_QUEUE_LEN);
+        if (!received) {
+            return;
+        }
+        memcpy((uint8_t *)received->data.raw, (uint8_t *)data, size);
+        memcpy((uint8_t *)received->addr, (uint8_t *)addr, MAC_ADDRESS_LEN);
+        received->size = size;
+
+        // publish slot to the main loop or the protocol task
+        recv_queue_.commit();
+        wake_();
+
+    }
+
+    void ESPNowProxy::on_stream_chunk_(ESPNowProxyPeer *peer, const stream_chunk_t &chunk) {
+
+        auto peer_addr_a64 = peer->get_address();
+        if (chunk.aborted) {
+            ESP_LOGW(TAG, "Message %d from %s aborted at %d / %d", chunk.message_id, mac_str(peer_addr_a64).c_str(), chunk.offset, chunk.total_len);
+        }
+        notify_(Event_StreamData, peer, chunk.data, chunk.size, &chunk);
+
+    }
+
+    void ESPNowProxy::dispatch_command_data_(ESPNowProxyPeer *peer, const uint8_t *data, size_t size) {
+
+        notify_(Event_CommandData, peer, data, size);
+
+    }
+
+    void ESPNowProxy::notify_(uint8_t event, ESPNowProxyPeer *peer, const uint8_t *data, size_t size, const stream_chunk_t *chunk) {
+
+#ifdef USE_ESPNOW_PROXY_TASK
+        // running on the protocol task, hand a copy to the main loop
+        if (task_) {
+            event_data_t *queued = event_queue_.acquire();
+            if (!queued) {
+                ESP_LOGW(TAG, "Event queue full, dropping event %d", event);
+                return;
+            }
+            queued->type = event;
+            queued->peer = peer;
+            queued->size = size;
+            if (size) {
+                memcpy(queued->data.raw, data, size);
+            }
+            if (chunk) {
+                queued->chunk = *chunk;
+            }
+            event_queue_.commit();
+            return;
+        }
+#endif
+        call_(event, peer, data, size, chunk);
+
+    }
+
+    void ESPNowProxy::call_(uint8_t event, ESPNowProxyPeer *peer, const uint8_t *data, size_t size, const stream_chunk_t *chunk) {
+
+        // received data is borrowed from the receive slot, no copy
+        switch (event) {
+            case Event_PacketData:
+                {
+                    const packet_data_t &packet = *(const packet_data_t *)data;
+                    on_packet_data_callback.call(peer->get_address(), packet);
+                    peer->on_packet_data_callback.call(peer->get_address(), packet);
+                }
+                break;
+
+            case Event_CommandData:
+                {
+                    std::string_view command_data((const char *)data, size);
+                    on_command_data_callback.call(peer->get_address(), command_data);
+                    peer->on_command_data_callback.call(peer->get_address(), command_data);
+                }
+                break;
+
+            case Event_StreamData:
+                on_stream_data_callback.call(peer->get_address(), *chunk);
+                peer->on_stream_data_callback.call(peer->get_address(), *chunk);
+                break;
+
+            case Event_SendStarted:
+                on_send_started_callback.call();
+                break;
+
+            case Event_SendFinished:
+                on_send_finished_callback.call();
+                break;
+
+            case Event_SendFailed:
+                on_send_failed_callback.call();
+                break;
+
+            case Event_RpcRequest:
+                dispatch_rpc_request_(peer, data, size);
+                break;
+
+            case Event_RpcResponse:
+                dispatch_rpc_response_(peer, data, size);
+                break;
+        }
+
+    }
+
+    void ESPNowProxy::wake_() {
+
+#ifdef USE_ESPNOW_PROXY_TASK
+        if (task_) {
+            xTaskNotifyGive(task_);
+        }
+#endif
+
+    }
+
+#ifdef USE_ESPNOW_PROXY_TASK
+    void ESPNowProxy::task_loop_(void *arg) {
+
+        // woken by received frames and new messages, polls for timers
+        ESPNowProxy *proxy = (ESPNowProxy *)arg;
+        TickType_t poll = std::max((TickType_t)pdMS_TO_TICKS(TASK_POLL_MS), (TickType_t)1);
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, poll);
+            proxy->process_protocol_();
+        }
+
+    }
+
+    void ESPNowProxy::process_events_() {
+
+        event_data_t *event;
+        while ((event = event_queue_.front()) != nullptr) {
+            if (event->type == Event_StreamData) {
+                event->chunk.data = event->size ? event->data.raw : nullptr;
+            }
+            call_(event->type, event->peer, event->data.raw, event->size, &event->chunk);
+            event_queue_.pop();
+        }
+
+    }
+#endif
+
+    // public functions
+
+    delivery_handle_t ESPNowProxy::send(const char *data, const send_options_t &options) {
+
+        // payload is the string including its terminator, in a single frame
+        // as well as fragmented
+        PROTOCOL_LOCK();
+        size_t size = strnlen(data, MAX_MESSAGE_LEN) + 1;
+        if (size > MAX_PAYLOAD_LENGTH) {
+            return send_fragmented_((const uint8_t *)data, size, options);
+        }
+
+        return send_data_((const uint8_t *)data, size, options);
+
+    }
+
+    delivery_handle_t ESPNowProxy::send(const char *data) {
+        return ESPNowProxy::send(data, send_options_t{});
+    }
+
+    delivery_handle_t ESPNowProxy::send(const std::string &data, const send_options_t &options) {
+        return ESPNowProxy::send(data.c_str(), options);
+    }
+
+    delivery_handle_t ESPNowProxy::send(const std::string &data) {
+        return ESPNowProxy::send(data.c_str());
+    }
+
+    delivery_handle_t ESPNowProxy::send(const uint8_t *data, size_t size, const send_options_t &options) {
+
+        // binary payload, sent as is
+        PROTOCOL_LOCK();
+        if (size > MAX_PAYLOAD_LENGTH) {
+            return send_fragmented_(data, size, options);
+        }
+
+        return send_data_(data, size, options);
+
+    }
+
+    send_data_t *ESPNowProxy::reserve_send(const send_options_t &options) {
+
+        PROTOCOL_LOCK();
+        send_data_t *message = alloc_send_(options, Command_Data);
+        if (!message) {
+            mac_address_t address = options.address ? options.address : get_send_address_();
+            report_delivery_(delivery_handle_t{}, address, Delivery_Dropped, options.on_delivery);
+            return nullptr;
+        }
+        message->delivery = open_delivery_(message->address, options.on_delivery).id;
+
+        return message;
+
+    }
+
+    delivery_handle_t ESPNowProxy::commit_send(send_data_t *message, size_t size) {
+
+        if (!message) {
+            return delivery_handle_t{};
+        }
+        PROTOCOL_LOCK();
+        if (size > MAX_PAYLOAD_LENGTH) {
+            ESP_LOGW(TAG, "Message too large (%zu / %zu), dropping command", size, MAX_PAYLOAD_LENGTH);
+            complete_message_(message, Delivery_Dropped);
+            return delivery_handle_t{};
+        }
+        message->size = size;
+        delivery_handle_t handle{message->delivery};
+        if (!queue_send_(message)) {
+            return delivery_handle_t{};
+        }
+
+        return handle;
+
+    }
+
+    void ESPNowProxy::cancel_send(send_data_t *message) {
+        PROTOCOL_LOCK();
+        complete_message_(message, Delivery_Dropped);
+    }
+
+    uint8_t ESPNowProxy::get_delivery_status(delivery_handle_t handle) {
+
+        if (!handle) {
+            return Delivery_Dropped;
+        }
+        PROTOCOL_LOCK();
+        delivery_t *delivery = &deliveries_[handle.id & (DELIVERY_LEN - 1)];
+
+        return delivery->id == handle.id ? delivery->status : Delivery_Unknown;
+
+    }
+
+    uint16_t ESPNowProxy::call(
+        mac_address_t address, uint8_t method, const uint8_t *data, size_t size, rpc_callback_t callback, uint32_t timeout) {
+
+        PROTOCOL_LOCK();
+        address = address ? address : get_send_address_();
+        if (address == addr_to_addr64(espnow_proxy_base::BROADCAST)) {
+            ESP_LOGW(TAG, "Calls need a receiver, dropping request");
+        } else if (size > MAX_RPC_DATA_LEN) {
+            ESP_LOGW(TAG, "Request too large (%zu / %zu), dropping request", size, MAX_RPC_DATA_LEN);
+        } else {
+            rpc_pending_t *pending = nullptr;
+            for (auto &item : rpc_pending_) {
+                if (item.state == RpcSlot_Free) {
+                    pending = &item;
+                    break;
+                }
+            }
+            send_options_t options{address, Priority_Control};
+            send_data_t *message = pending ? alloc_send_(options, Command_Request) : nullptr;
+            if (!pending) {
+                ESP_LOGW(TAG, "Too many outstanding requests, dropping request");
+            }
+            if (message) {
+                // request ids wrap around, 0 stays invalid
+                if (++last_request_id_ == 0) {
+                    ++last_request_id_;
+                }
+                rpc_header_t header{last_request_id_, method, Rpc_Ok};
+                memcpy(message->data, &header, RPC_HEADER_LEN);
+                memcpy(message->data + RPC_HEADER_LEN, data, size);
+                message->size = RPC_HEADER_LEN + size;
+                pending->request_id = last_request_id_;
+                pending->method = method;
+                pending->status = Rpc_Ok;
+                pending->address = address;
+                pending->time = clock_millis();
+                pending->deadline = pending->time + (timeout ? timeout : rpc_timeout_);
+                pending->callback = std::move(callback);
+                if (queue_send_(message)) {
+                    pending->state = RpcSlot_Pending;
+                    rpc_method_t *stats = get_rpc_method_(method, true);
+                    if (stats) {
+                        stats->stats.calls++;
+                    }
+                    return last_request_id_;
+                }
+                callback = std::move(pending->callback);
+                pending->callback = nullptr;
+            }
+        }
+
+        report_rpc_(address, method, Rpc_Dropped, std::string_view(), callback);
+        return 0;
+
+    }
+
+    uint16_t ESPNowProxy::call(mac_address_t address, uint8_t method, const std::string &data, rpc_callback_t callback, uint32_t timeout) {
+        return ESPNowProxy::call(address, method, (const uint8_t *)data.data(), data.size(), std::move(callback), timeout);
+    }
+
+    bool ESPNowProxy::register_method(uint8_t method, rpc_handler_t handler) {
+
+        PROTOCOL_LOCK();
+        rpc_method_t *item = get_rpc_method_(method, true);
+        if (!item) {
+            ESP_LOGW(TAG, "Too many rpc methods, not registering method %d", method);
+            return false;
+        }
+        item->handler = std::move(handler);
+
+        return true;
+
+    }
+
+    bool ESPNowProxy::respond(const rpc_request_t &request, const uint8_t *data, size_t size, uint8_t status) {
+
+        // sequenced like data, the requester acks the response
+        PROTOCOL_LOCK();
+        if (size > MAX_RPC_DATA_LEN) {
+            ESP_LOGW(TAG, "Response too large (%zu / %zu), answering with an error", size, MAX_RPC_DATA_LEN);
+            size = 0;
+            status = Rpc_Error;
+        }
+        send_options_t options{request.address, Priority_Control};
+        send_data_t *message = alloc_send_(options, Command_Response);
+        if (!message) {
+            return false;
+        }
+        rpc_header_t header{request.request_id, request.method, status};
+        memcpy(message->data, &header, RPC_HEADER_LEN);
+        if (size) {
+            memcpy(message->data + RPC_HEADER_LEN, data, size);
+        }
+        message->size = RPC_HEADER_LEN + size;
+        if (!queue_send_(message)) {
+            return false;
+        }
+
+        // the response acks the request, the delayed ack is only still owed
+        // for frames received after it
+        ESPNowProxyPeer *peer = get_peer_by_mac_address_(request.address);
+        if (
+            peer && peer->get_ack_pending(request.space) == 1 &&
+            peer->get_rx_window(request.space)->highest == request.packet_id
+        ) {
+            peer->set_ack_pending(request.space, 0);
+        }
+        rpc_method_t *item = get_rpc_method_(request.method, false);
+        if (item) {
+            item->stats.served++;
+        }
+
+        return true;
+
+    }
+
+    bool ESPNowProxy::respond(const rpc_request_t &request, const std::string &data, uint8_t status) {
+        return ESPNowProxy::respond(request, (const uint8_t *)data.data(), data.size(), status);
+    }
+
+    const rpc_stats_t *ESPNowProxy::get_rpc_stats(uint8_t method) {
+
+        PROTOCOL_LOCK();
+        rpc_method_t *item = get_rpc_method_(method, false);
+
+        return item ? &item->stats : nullptr;
+
+    }
+
+    void ESPNowProxy::copy_link_stats(mac_address_t address, link_stats_t *stats, rtt_estimator_t *rtt) {
+
+        PROTOCOL_LOCK();
+        ESPNowProxyBase *link = get_link_(address);
+        *stats = *link->get_stats();
+        *rtt = *link->get_rtt();
+
+    }
+
+    bool ESPNowProxy::copy_rpc_stats(uint8_t method, rpc_stats_t *stats) {
+
+        PROTOCOL_LOCK();
+        rpc_method_t *item = get_rpc_method_(method, false);
+        if (!item) {
+            return false;
+        }
+        *stats = item->stats;
+        return true;
+
+    }
+
+    void ESPNowProxy::setup() {
+
+        // setup callbacks (send/recv)
+        espnow_proxy_base::add_send_callback(
+            [&](const uint8_t *addr, uint8_t status, const packet_data_t *frame) { on_send_(addr, status, frame); }
+        );
+        espnow_proxy_base::add_recv_callback(
+            [&](const uint8_t *addr, const uint8_t *data, int size) { on_recv_(addr, data, size); }
+        );
+
+        // prepare connection
+        setup_wifi_();
+
+        // continue packet ids and register known peers before the first send
+        if (persist_) {
+            restore_state_();
+        }
+
+#ifdef USE_ESPNOW_PROXY_TASK
+        // protocol work moves to its own task, loop() only dispatches callbacks
+        mutex_ = xSemaphoreCreateRecursiveMutex();
+        BaseType_t created = mutex_ && xTaskCreatePinnedToCore(
+            task_loop_, "espnow_proxy", task_stack_size_, this, task_priority_, &task_,
+            task_core_ < 0 ? tskNO_AFFINITY : task_core_);
+        if (created != pdPASS) {
+            ESP_LOGW(TAG, "Could not start protocol task, running in loop");
+            task_ = nullptr;
+        }
+#endif
+
+    }
+
+    void ESPNowProxy::loop() {
+
+        if (!espnow_proxy_base::is_ready()) {
+            ESP_LOGD(TAG, "ESPNow not ready, trying to start in loop");
+            setup_wifi_();
+        }
+
+        // reserved packet ids and learned peers, the preferences batch the
+        // actual flash writes
+        if (persist_dirty_) {
+            save_state_(false);
+        }
+
+#ifdef USE_ESPNOW_PROXY_TASK
+        if (task_) {
+            process_events_();
+            process_deliveries_();
+            process_rpc_();
+            return;
+        }
+#endif
+
+        // alternate receiving and sending until both are idle or the
+        // budget of this iteration is used up
+        uint32_t start = clock_micros();
+        process_send_status_();
+        pre_process_queues_();
+        process_acks_();
+        process_streams_();
+        uint8_t count = 0;
+        while (true) {
+            bool received = process_recv_queue_();
+            bool sent = process_send_queue_();
+            if (!received && !sent) {
+                break;
+            }
+            if (++count >= loop_budget_messages_ || clock_micros() - start >= loop_budget_time_) {
+                loop_budget_exhausted_++;
+                break;
+            }
+        }
+        loop_time_ = clock_micros() - start;
+        loop_time_max_ = std::max(loop_time_, loop_time_max_);
+        process_deliveries_();
+        process_rpc_();
+
+    }
+
+    bool ESPNowProxy::process_protocol_() {
+
+        // everything queued so far, the task is not bound to the loop cadence
+        PROTOCOL_LOCK();
+        process_send_status_();
+        pre_process_queues_();
+        bool processed = process_acks_();
+        processed |= process_streams_();
+        while (process_recv_queue_()) {
+            processed = true;
+        }
+        processed |= process_send_queue_();
+        return processed;
+
+    }
+
+    void ESPNowProxy::dump_config() {
+
+        PROTOCOL_LOCK();
+        ESP_LOGCONFIG(TAG, "ESPNowProxy...");
+        ESP_LOGCONFIG(TAG, "  Connection State: %d", espnow_proxy_base::is_ready());
+        if (address_) {
+            ESP_LOGCONFIG(TAG, "  Receiver Address: %s", mac_str(get_address()).c_str());
+        } else {
+            ESP_LOGCONFIG(TAG, "  Receiver Broadcast");
+        }
+        ESP_LOGCONFIG(TAG, "  Window Size: %d", window_size_);
+        ESP_LOGCONFIG(
+            TAG, "  Retransmit Timeout: %u ms (min: %u ms, max: %u ms)",
+            retransmit_timeout_,
+            min_retransmit_timeout_,
+            max_retransmit_timeout_);
+        ESP_LOGCONFIG(TAG, "  Ack Delay: %u ms", ack_delay_);
+        ESP_LOGCONFIG(
+            TAG, "  Broadcast Mode: %s (history: %u ms)",
+            broadcast_mode_ == BroadcastMode_Nack ? "nack" : broadcast_mode_ == BroadcastMode_Unacked ? "unacked" : "ack",
+            broadcast_history_);
+        if (batching_) {
+            ESP_LOGCONFIG(TAG, "  Batching: linger %u ms", batch_linger_);
+        }
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+        ESP_LOGCONFIG(
+            TAG, "  Fragmentation: max %d bytes, %zu / %zu slots (high water: %zu, rejected: %u), timeout %u ms",
+            MAX_MESSAGE_LEN,
+            reassembly_.held(),
+            reassembly_.capacity(),
+            reassembly_.get_high_water(),
+            reassembly_.get_rejected(),
+            reassembly_timeout_);
+#endif
+        ESP_LOGCONFIG(
+            TAG, "  Recv Queue: %zu / %zu (limit: %d, drop: %s, overflow: %u, shed: %u)",
+            recv_queue_.size(),
+            recv_queue_.capacity(),
+            recv_limit_,
+            recv_drop_policy_ == RecvDrop_Oldest ? "oldest" : recv_drop_policy_ == RecvDrop_Priority ? "priority" : "newest",
+            recv_queue_.get_overflow(),
+            recv_shed_);
+        ESP_LOGCONFIG(TAG, "  Flow Control: %s", flow_control_ ? "yes" : "no");
+        ESP_LOGCONFIG(
+            TAG, "  Recv Pool: %zu slots (high water: %u, exhausted: %u)",
+            recv_queue_.capacity(),
+            recv_queue_.get_high_water(),
+            recv_queue_.get_overflow());
+        ESP_LOGCONFIG(
+            TAG, "  Send Pool: %zu / %zu (high water: %zu, exhausted: %u)",
+            send_pool_.in_use(),
+            send_pool_.capacity(),
+            send_pool_.get_high_water(),
+            send_pool_.get_exhausted());
+        ESP_LOGCONFIG(TAG, "  Send Queue: %zu / %d per peer", send_queue_.size(), max_queue_length_);
+        ESP_LOGCONFIG(
+            TAG, "  Transmit Frames: %d (exhausted: %u)",
+            TX_FRAME_POOL_LEN,
+            espnow_proxy_base::get_state().frames_exhausted);
+        ESP_LOGCONFIG(
+            TAG, "  Loop Budget: %d messages, %u us (loop time: %u us, max: %u us, exhausted: %u)",
+            loop_budget_messages_,
+            loop_budget_time_,
+            loop_time_,
+            loop_time_max_,
+            loop_budget_exhausted_);
+#ifdef USE_ESPNOW_PROXY_TASK
+        ESP_LOGCONFIG(
+            TAG, "  Protocol Task: %s (priority: %d, core: %d, events: %zu / %zu, overflow: %u)",
+            task_ ? "running" : "not running",
+            task_priority_,
+            task_core_,
+            event_queue_.size(),
+            event_queue_.capacity(),
+            event_queue_.get_overflow());
+#endif
+        ESP_LOGCONFIG(
+            TAG, "  Persist State: %s (reserve: %d, next packet id: %d)",
+            persist_ ? "yes" : "no",
+            persist_reserve_,
+            peek_packet_id());
+        uint8_t rpc_outstanding = 0;
+        for (auto &pending : rpc_pending_) {
+            rpc_outstanding += pending.state != RpcSlot_Free;
+        }
+        ESP_LOGCONFIG(
+            TAG, "  RPC: timeout %u ms, outstanding: %d / %d",
+            rpc_timeout_,
+            rpc_outstanding,
+            RPC_PENDING_LEN);
+        for (auto &item : rpc_methods_) {
+            if (!item.used) {
+                continue;
+            }
+            ESP_LOGCONFIG(
+                TAG, "    Method %d%s - calls: %u, errors: %u, timeouts: %u, served: %u, p50: %u ms, p90: %u ms",
+                item.method,
+                item.handler ? " (handler)" : "",
+                item.stats.calls,
+                item.stats.errors,
+                item.stats.timeouts,
+                item.stats.served,
+                histogram_percentile(item.stats.latency, 50),
+                histogram_percentile(item.stats.latency, 90));
+        }
+#ifdef USE_ESPNOW_PROXY_PACKET_LOG
+        ESP_LOGCONFIG(TAG, "  Packet Log: enabled");
+#endif
+#ifdef USE_ESPNOW_PROXY_TRACE
+        ESP_LOGCONFIG(TAG, "  Trace: %u events (buffer: %d)", trace_count(), TRACE_LEN);
+#endif
+
+        // peers configured
+        ESP_LOGCONFIG(
+            TAG, "  Peers: %zu addresses in %zu slots (probes: %u)",
+            peer_table_.size(),
+            peer_table_.capacity(),
+            peer_table_.get_probes());
+        for (auto peer : peers_) {
+            ESP_LOGCONFIG(
+                TAG, "    Peer %s - address: %s - srtt: %u ms, rto: %u ms, queued: %zu, credit: %d",
+                peer->get_name_prefix().c_str(),
+                mac_str(peer->get_address()).c_str(),
+                peer->get_rtt()->srtt8 >> 3,
+                peer->get_rtt()->rto,
+                peer->get_send_queue()->size(),
+                peer->get_credit() == CREDIT_UNKNOWN ? -1 : peer->get_credit());
+        }
+
+        // esp now peers
+        radio_peer_t peers[MAX_PEERS];
+        int total = espnow_proxy_base::list_peers(peers, MAX_PEERS);
+        ESP_LOGCONFIG(TAG, "  ESPNow Peers:");
+        for (auto idx = 0; idx < total && idx < MAX_PEERS; idx++) {
+            radio_peer_t peer = peers[idx];
+            mac_address_t address = espnow_proxy_base::addr_to_addr64(peer.addr);
+            ESP_LOGCONFIG(
+                TAG, "    ESPNow Peer - address: %s - ifidx: %d%s",
+                mac_str(peer.addr).c_str(),
+                peer.ifidx,
+                address_ == address ? " <- Receiver" : "");
+        }
+        ESP_LOGCONFIG(TAG, "    ... total (%d)", total);
+        const peer_registry_t *registry = espnow_proxy_base::get_peer_registry();
+        ESP_LOGCONFIG(
+            TAG, "  Peer Registry: %d / %d (radio: %d / %d, hits: %u, misses: %u, evictions: %u)",
+            registry->count,
+            PEER_REGISTRY_LEN,
+            registry->registered,
+            RADIO_PEER_LEN,
+            registry->hits,
+            registry->misses,
+            registry->evictions);
+
+    }
+
+    void ESPNowProxy::on_shutdown() {
+
+        // exact packet ids, a warm start continues without a gap
+        if (persist_) {
+            save_state_(true);
+            global_preferences->sync();
+        }
+
+    }
+
+    void ESPNowProxy::restore_state_() {
+
+        persist_pref_ = global_preferences->make_preference<persist_state_t>(GLOBAL_PACKET_ID_PREFS_ID, true);
+        persist_state_t state{};
+        if (!persist_pref_.load(&state)) {
+            ESP_LOGD(TAG, "No persisted state");
+            state.count = 0;
+        } else {
+            set_packet_id(state.packet_id);
+            set_packet_id_reserved(state.packet_id);
+        }
+
+        for (auto idx = 0; idx < state.count && idx < PERSIST_PEER_LEN; idx++) {
+            persist_peer_t *item = &state.peers[idx];
+            auto entry = peer_table_.find(item->address);
+            if (!entry || entry->alias) {
+                continue;
+            }
+            ESPNowProxyPeer *peer = entry->value;
+            peer->set_packet_id(item->packet_id);
+            peer->set_packet_id_reserved(item->packet_id);
+            espnow_proxy_base::add_peer(addr64_to_addr(item->address), item->channel, item->ifidx);
+            if (item->flags & PERSIST_FLAG_SOFTAP) {
+                auto alias = peer_table_.find(softap_alias(item->address));
+                if (alias && alias->value == peer) {
+                    espnow_proxy_base::add_peer(addr64_to_addr(alias->address), item->channel, item->ifidx);
+                    alias->registered = true;
+                }
+            }
+        }
+
+        // peers not seen before are registered right away as well
+        for (auto peer : peers_) {
+            if (!espnow_proxy_base::has_peer(addr64_to_addr(peer->get_address()))) {
+                espnow_proxy_base::add_peer(addr64_to_addr(peer->get_address()));
+            }
+        }
+        ESP_LOGD(TAG, "Restored state of %d peers (packet id: %d)", state.count, peek_packet_id());
+
+    }
+
+    void ESPNowProxy::save_state_(bool exact) {
+
+        PROTOCOL_LOCK();
+        persist_dirty_ = false;
+        persist_state_t state{};
+        state.packet_id = exact ? peek_packet_id() : get_packet_id_reserved();
+
+        // channel and interface as known to the peer registry
+        radio_peer_t registered[PEER_REGISTRY_LEN];
+        int total = std::min(espnow_proxy_base::list_peers(registered, PEER_REGISTRY_LEN), PEER_REGISTRY_LEN);
+        for (auto peer : peers_) {
+            if (state.count >= PERSIST_PEER_LEN) {
+                ESP_LOGW(
+                    TAG, "Persisting %d of %d peers, the others start with new packet ids after a restart",
+                    PERSIST_PEER_LEN, (int)peers_.size());
+                break;
+            }
+            persist_peer_t *item = &state.peers[state.count++];
+            item->address = peer->get_address();
+            item->packet_id = exact ? peer->peek_packet_id() : peer->get_packet_id_reserved();
+            for (auto idx = 0; idx < total; idx++) {
+                if (addr_to_addr64(registered[idx].addr) == item->address) {
+                    item->channel = registered[idx].channel;
+                    item->ifidx = registered[idx].ifidx;
+                }
+            }
+            auto alias = peer_table_.find(softap_alias(item->address));
+            if (alias && alias->value == peer && alias->registered) {
+                item->flags |= PERSIST_FLAG_SOFTAP;
+            }
+        }
+        persist_pref_.save(&state);
+
+    }
+
+    void ESPNowProxy::reserve_packet_id_(ESPNowProxyBase *link) {
+
+        // reserve the next block of packet ids once the persisted one is used
+        if (persist_ && (int16_t)(link->peek_packet_id() - link->get_packet_id_reserved()) > 0) {
+            link->set_packet_id_reserved(link->peek_packet_id() + persist_reserve_);
+            persist_dirty_ = true;
+        }
+
+    }
+
+    void ESPNowProxy::dump_trace() {
+
+#ifdef USE_ESPNOW_PROXY_TRACE
+        // one line per event, oldest first
+        static const char *EVENTS[] = {
+            "recv", "deliver", "duplicate", "queue", "drop", "send", "retransmit", "timeout", "acked", "nack", "send_fail", "replace"};
+        trace_event_t events[16];
+        size_t offset = 0;
+        PROTOCOL_LOCK();
+        ESP_LOGI(TAG, "Trace: %u events", trace_count());
+        while (size_t count = trace_read(events, sizeof(events) / sizeof(events[0]), offset)) {
+            for (size_t i = 0; i < count; i++) {
+                trace_event_t *event = &events[i];
+                ESP_LOGI(
+                    TAG, "  %10u %-10s cmd: 0x%02x id: %5d peer: ..:%02x:%02x",
+                    event->time,
+                    event->event < sizeof(EVENTS) / sizeof(EVENTS[0]) ? EVENTS[event->event] : "?",
+                    event->command,
+                    event->packet_id,
+                    event->address >> 8,
+                    event->address & 0xFF);
+            }
+            offset += count;
+        }
+#else
+        ESP_LOGW(TAG, "Trace not enabled, set trace_size");
+#endif
+
+    }
+
+    ESPNowProxyPeer *ESPNowProxy::set_peer(mac_address_t address) {
+
+        auto peer = create_peer_(address);
+        if (!peer_table_.insert(address, peer)) {
+            ESP_LOGW(TAG, "Peer table full, peer %s not reachable", mac_str(address).c_str());
+        }
+        peers_.push_back(peer);
+        links_.push_back(peer);
+
+        return peer;
+
+    }
+
+    //
+    // deliveries
+    //
+
+    delivery_handle_t ESPNowProxy::open_delivery_(mac_address_t address, const delivery_callback_t &callback) {
+
+        // ids wrap around, 0 stays invalid
+        if (++last_delivery_ == 0) {
+            ++last_delivery_;
+        }
+        delivery_t *delivery = &deliveries_[last_delivery_ & (DELIVERY_LEN - 1)];
+        if (delivery->id && !delivery->reported) {
+            ESP_LOGW(TAG, "Delivery table full, losing status of handle %u", delivery->id);
+        }
+        delivery->id = last_delivery_;
+        delivery->status = Delivery_Pending;
+        delivery->reported = false;
+        delivery->address = address;
+        delivery->callback = callback;
+
+        return delivery_handle_t{last_delivery_};
+
+    }
+
+    void ESPNowProxy::close_delivery_(uint32_t id, uint8_t status) {
+
+        // reported from loop(), the caller may be iterating a send queue
+        if (!id) {
+            return;
+        }
+        delivery_t *delivery = &deliveries_[id & (DELIVERY_LEN - 1)];
+        if (delivery->id != id || delivery->status != Delivery_Pending) {
+            return;
+        }
+        delivery->status = status;
+        deliveries_done_ = true;
+
+    }
+
+    void ESPNowProxy::complete_message_(send_data_t *message, uint8_t status) {
+
+        if (message->command == Command_Request && status != Delivery_Acked) {
+            fail_rpc_(message);
+        }
+        close_delivery_(message->delivery, status);
+        send_pool_.release(message);
+
+    }
+
+    void ESPNowProxy::report_delivery_(delivery_handle_t handle, mac_address_t address, uint8_t status, const delivery_callback_t &callback) {
+
+        if (callback) {
+            callback(handle, status);
+        }
+        on_delivery_callback.call(address, handle.id, status);
+        ESPNowProxyBase *link = get_link_(address);
+        if (link != this) {
+            link->on_delivery_callback.call(address, handle.id, status);
+        }
+
+    }
+
+    void ESPNowProxy::process_deliveries_() {
+
+        {
+            PROTOCOL_LOCK();
+            if (!deliveries_done_) {
+                return;
+            }
+            deliveries_done_ = false;
+        }
+        for (auto &delivery : deliveries_) {
+            delivery_handle_t handle;
+            mac_address_t address;
+            uint8_t status;
+            delivery_callback_t callback;
+            {
+                // callbacks may send, they run without the lock
+                PROTOCOL_LOCK();
+                if (delivery.reported || delivery.status == Delivery_Pending) {
+                    continue;
+                }
+                delivery.reported = true;
+                handle.id = delivery.id;
+                address = delivery.address;
+                status = delivery.status;
+                callback = std::move(delivery.callback);
+                delivery.callback = nullptr;
+            }
+            report_delivery_(handle, address, status, callback);
+        }
+
+    }
+
+    //
+    // rpc
+    //
+
+    ESPNowProxy::rpc_method_t *ESPNowProxy::get_rpc_method_(uint8_t method, bool create) {
+
+        rpc_method_t *free = nullptr;
+        for (auto &item : rpc_methods_) {
+            if (item.used && item.method == method) {
+                return &item;
+            }
+            if (!item.used && !free) {
+                free = &item;
+            }
+        }
+        if (!create || !free) {
+            return nullptr;
+        }
+        free->used = true;
+        free->method = method;
+
+        return free;
+
+    }
+
+    send_data_t *ESPNowProxy::take_request_(mac_address_t peer_address, mac_address_t sender_address, uint16_t request_id) {
+
+        // the request was queued for the peer or for the receiver
+        ESPNowProxyBase *links[] = {get_link_(peer_address), this};
+        for (auto link : links) {
+            auto queue = link->get_send_queue();
+            for (auto it = queue->begin(); it != queue->end(); ++it) {
+                send_data_t *item = *it;
+                rpc_header_t header;
+                memcpy(&header, item->data, RPC_HEADER_LEN);
+                if (
+                    item->command == Command_Request && item->retries > 0 &&
+                    is_same_link_(item, peer_address, sender_address) && header.request_id == request_id
+                ) {
+                    queue->erase(it);
+                    return item;
+                }
+            }
+            if (link == this) {
+                break;
+            }
+        }
+
+        return nullptr;
+
+    }
+
+    bool ESPNowProxy::on_rpc_response_(
+        mac_address_t peer_address, mac_address_t sender_address, const rpc_header_t &header, uint32_t current) {
+
+        // the response acks its request, no separate DataAck
+        send_data_t *request = take_request_(peer_address, sender_address, header.request_id);
+        if (request) {
+            ack_message_(request, current);
+        }
+
+        // the callback runs from the main loop, latency is taken now
+        for (auto &pending : rpc_pending_) {
+            if (
+                pending.state != RpcSlot_Pending || pending.request_id != header.request_id ||
+                (pending.address != peer_address && pending.address != sender_address)
+            ) {
+                continue;
+            }
+            pending.state = RpcSlot_Answered;
+            pending.status = header.status;
+            pending.answered_by = peer_address;
+            rpc_method_t *method = get_rpc_method_(pending.method, true);
+            if (method) {
+                method->stats.responses++;
+                if (header.status != Rpc_Ok) {
+                    method->stats.errors++;
+                }
+                histogram_add(method->stats.latency, current - pending.time);
+            }
+            return true;
+        }
+
+        // late response, the call timed out already
+        return false;
+
+    }
+
+    void ESPNowProxy::fail_rpc_(send_data_t *request) {
+
+        // the request timed out or was dropped at the link, the call fails
+        // from the main loop without waiting for its deadline
+        rpc_header_t header;
+        memcpy(&header, request->data, RPC_HEADER_LEN);
+        for (auto &pending : rpc_pending_) {
+            if (
+                pending.state == RpcSlot_Pending && pending.request_id == header.request_id &&
+                pending.address == request->address
+            ) {
+                pending.state = RpcSlot_Failed;
+                pending.status = Rpc_Dropped;
+                return;
+            }
+        }
+
+    }
+
+    void ESPNowProxy::report_rpc_(
+        mac_address_t address, uint8_t method, uint8_t status, std::string_view data, const rpc_callback_t &callback) {
+
+        if (callback) {
+            callback(status, data);
+        }
+        on_rpc_response_callback.call(address, method, status, data);
+        ESPNowProxyBase *link = get_link_(address);
+        if (link != this) {
+            link->on_rpc_response_callback.call(address, method, status, data);
+        }
+
+    }
+
+    void ESPNowProxy::dispatch_rpc_request_(ESPNowProxyPeer *peer, const uint8_t *data, size_t size) {
+
+        // the whole frame, respond() needs its packet id to ack it
+        command_header_t command_header;
+        memcpy(&command_header, data, HEADER_LEN);
+        data += HEADER_LEN;
+        size -= HEADER_LEN;
+        rpc_header_t header;
+        memcpy(&header, data, RPC_HEADER_LEN);
+        uint8_t flags = command_header.command & COMMAND_FLAG_MASK;
+        rpc_request_t request{
+            peer->get_address(), header.request_id, header.method, command_header.packet_id,
+            (uint8_t)(flags & (COMMAND_FLAG_NO_ACK | COMMAND_FLAG_SHARED) ? Space_Shared : Space_Peer)};
+        rpc_handler_t handler;
+        {
+            PROTOCOL_LOCK();
+            rpc_method_t *method = get_rpc_method_(header.method, false);
+            if (method) {
+                handler = method->handler;
+            }
+        }
+        if (!handler) {
+            ESP_LOGW(TAG, "No handler for rpc method %d from %s", header.method, mac_str(request.address).c_str());
+            respond(request, nullptr, 0, Rpc_UnknownMethod);
+            return;
+        }
+        handler(request, std::string_view((const char *)data + RPC_HEADER_LEN, size - RPC_HEADER_LEN));
+
+    }
+
+    void ESPNowProxy::dispatch_rpc_response_(ESPNowProxyPeer *peer, const uint8_t *data, size_t size) {
+
+        rpc_header_t header;
+        memcpy(&header, data, RPC_HEADER_LEN);
+        rpc_callback_t callback;
+        mac_address_t address = peer->get_address();
+        {
+            PROTOCOL_LOCK();
+            rpc_pending_t *answered = nullptr;
+            for (auto &pending : rpc_pending_) {
+                if (
+                    pending.state == RpcSlot_Answered && pending.request_id == header.request_id &&
+                    pending.answered_by == address
+                ) {
+                    answered = &pending;
+                    break;
+                }
+            }
+            if (!answered) {
+                return;
+            }
+            address = answered->address;
+            callback = std::move(answered->callback);
+            answered->callback = nullptr;
+            answered->state = RpcSlot_Free;
+        }
+        report_rpc_(
+            address, header.method, header.status,
+            std::string_view((const char *)data + RPC_HEADER_LEN, size - RPC_HEADER_LEN), callback);
+
+    }
+
+    void ESPNowProxy::process_rpc_() {
+
+        // calls past their deadline or whose request failed, the request is
+        // no longer retransmitted
+        uint32_t current = clock_millis();
+        for (auto &pending : rpc_pending_) {
+            mac_address_t address;
+            uint8_t method;
+            uint8_t status;
+            rpc_callback_t callback;
+            {
+                PROTOCOL_LOCK();
+                if (
+                    pending.state == RpcSlot_Free ||
+                    (pending.state != RpcSlot_Failed && (int32_t)(current - pending.deadline) < 0)
+                ) {
+                    continue;
+                }
+                if (pending.state == RpcSlot_Pending) {
+                    send_data_t *request = take_request_(pending.address, pending.address, pending.request_id);
+                    if (request) {
+                        complete_message_(request, Delivery_Timeout);
+                    }
+                    rpc_method_t *item = get_rpc_method_(pending.method, true);
+                    if (item) {
+                        item->stats.timeouts++;
+                    }
+                    pending.status = Rpc_Timeout;
+                }
+                // answered ones only get here if the event was lost
+                address = pending.address;
+                method = pending.method;
+                status = pending.status;
+                callback = std::move(pending.callback);
+                pending.callback = nullptr;
+                pending.state = RpcSlot_Free;
+            }
+            report_rpc_(address, method, status, std::string_view(), callback);
+        }
+
+    }
+
+    //
+    // queues
+    //
+
+    void ESPNowProxy::pre_process_queues_() {
+
+        // check exisiting queue items for invalidity
+        uint32_t current = clock_millis();
+        for (auto link : links_) {
+            auto queue = link->get_send_queue();
+            for (auto it = queue->begin(); it != queue->end();) {
+                send_data_t *item = *it;
+                bool keep = true;
+
+                // unacked broadcast, done once sent and no longer kept for nacks
+                if ((item->flags & COMMAND_FLAG_NO_ACK) && item->sent) {
+                    uint32_t history = item->flags & COMMAND_FLAG_NACK ? broadcast_history_ : 0;
+                    if ((int32_t)(current - item->tx_time) >= (int32_t)history) {
+                        it = queue->erase(it);
+                        complete_message_(item, Delivery_Sent);
+                    } else {
+                        ++it;
+                    }
+                    continue;
+                }
+
+                // superseded by a newer value, dropped instead of sent again
+                if (item->replaced && (int32_t)(current - item->tx_time) >= (int32_t)item->rto) {
+                    it = queue->erase(it);
+                    complete_message_(item, Delivery_Replaced);
+                    continue;
+                }
+
+                // check for retries
+                if (item->retries >= MAX_SEND_RETRIES) {
+
+                    // too many retries, remove item from queue
+                    ESP_LOGW(TAG, "Too many retries for sending to %s", mac_str(item->address).c_str());
+                    TRACE(Trace_Timeout, item->command, item->packet_id, item->address);
+                    link->get_stats()->timeouts++;
+                    keep = false;
+
+                // check for timeout
+                } else if (item->time && (int32_t)(current - item->time) > SEND_TIMEOUT_MS) {
+
+                    // timeout, remove item from queue
+                    ESP_LOGW(
+                        TAG, "Timeout occurred waiting for send ack from %s queue size: %zu (%u / %u)",
+                        mac_str(item->address).c_str(),
+                        queue->size(),
+                        current,
+                        item->time);
+                    TRACE(Trace_Timeout, item->command, item->packet_id, item->address);
+                    link->get_stats()->timeouts++;
+                    keep = false;
+
+                }
+
+                // decide what to do with item
+                if (!keep) {
+
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+                    // the receiver can not complete a message with a missing
+                    // fragment, the other ones are released right away
+                    if (item->command == Command_Fragment) {
+                        tx_stream_offset_ = tx_stream_len_;
+                        close_delivery_(tx_stream_delivery_, Delivery_Timeout);
+                        tx_stream_delivery_ = 0;
+                        for (auto other = queue->begin(); other != queue->end();) {
+                            if (*other != item && (*other)->command == Command_Fragment) {
+                                send_data_t *fragment = *other;
+                                other = queue->erase(other);
+                                complete_message_(fragment, Delivery_Timeout);
+                            } else {
+                                ++other;
+                            }
+                        }
+                        it = std::find(queue->begin(), queue->end(), item);
+                    }
+#endif
+
+                    // do not keep item in queue, release
+                    it = queue->erase(it);
+                    complete_message_(item, Delivery_Timeout);
+
+                } else {
+
+                    // keep item in queue
+                    ++it;
+
+                }
+            }
+        }
+
+    }
+
+    bool ESPNowProxy::window_open_(ESPNowProxyBase *link, const mac_address_t address) {
+
+        // messages with an attempt made are waiting for their ack
+        uint16_t next_packet_id = link->peek_packet_id();
+        auto queue = link->get_send_queue();
+        size_t count = 0;
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            send_data_t *item = *it;
+            if (item->retries == 0 || item->address != address) {
+                continue;
+            }
+            // unacked broadcasts are not waiting for anything
+            if ((item->flags & COMMAND_FLAG_NO_ACK) && item->sent) {
+                continue;
+            }
+            // messages packed into another frame share its packet id
+            if (item->batch && item->batch != item) {
+                continue;
+            }
+            // packet ids in flight must fit into the receivers ack window
+            if ((uint16_t)(next_packet_id - item->packet_id) >= SEQ_WINDOW_LEN) {
+                return false;
+            }
+            count++;
+        }
+
+        // no more in flight than the receiver grants. without any
+        // credit one frame probes after a retransmit timeout, in case the
+        // update got lost
+        size_t limit = window_size_;
+        if (link->get_credit() != CREDIT_UNKNOWN && address != addr_to_addr64(espnow_proxy_base::BROADCAST)) {
+            limit = std::min(limit, (size_t)link->get_credit());
+            if (!limit && !count && clock_millis() - link->get_credit_time() >= retransmit_timeout_) {
+                return true;
+            }
+        }
+        return count < limit;
+
+    }
+
+    bool ESPNowProxy::is_same_link_(const send_data_t *item, const mac_address_t peer_address, const mac_address_t sender_address) {
+
+        // packet ids are only unique within the sequence space of a destination
+        return (
+            item->address == peer_address ||
+            item->address == sender_address ||
+            item->address == addr_to_addr64(espnow_proxy_base::BROADCAST));
+
+    }
+
+    bool ESPNowProxy::send_ack_(ESPNowProxyPeer *peer, uint8_t space) {
+
+        // an ack covers one sequence space of the peer
+        uint16_t packet_id_acked;
+        uint32_t sack_bitmap;
+        seq_window_to_sack(peer->get_rx_window(space), &packet_id_acked, &sack_bitmap);
+        uint8_t credit = recv_credit_(peer->get_address());
+        PACKET_LOGD(
+            TAG, "Sending DataSack to %s (%d, 0x%08x, space: %d, pending: %d, credit: %d)",
+            mac_str(peer->get_address()).c_str(),
+            packet_id_acked,
+            sack_bitmap,
+            space,
+            peer->get_ack_pending(space),
+            credit);
+        bool sent = send_command_data_sack(
+            addr64_to_addr(peer->get_address()), packet_id_acked, sack_bitmap, credit, 0,
+            space == Space_Shared ? COMMAND_FLAG_SHARED : 0);
+        if (!sent) {
+            // still owed, tried again from process_acks_ in the next loop
+            return false;
+        }
+        peer->set_ack_pending(space, 0);
+        peer->set_credit_low(credit < recv_limit_ / 2);
+        return true;
+
+    }
+
+    uint8_t ESPNowProxy::recv_credit_(mac_address_t address) {
+
+        // slots below the limit not taken by other senders. queued frames of
+        // the peer itself are not acked yet and already count as in flight
+        if (!flow_control_) {
+            return CREDIT_UNKNOWN;
+        }
+        size_t depth = recv_queue_.size();
+        size_t others = 0;
+        for (size_t idx = 0; idx < depth; idx++) {
+            recv_data_t *item = recv_queue_.peek(idx);
+            others += item->size && addr_to_addr64(item->addr) != address;
+        }
+        return others < recv_limit_ ? std::min<size_t>(recv_limit_ - others, CREDIT_UNKNOWN - 1) : 0;
+
+    }
+
+    void ESPNowProxy::shed_recv_queue_() {
+
+        // overload, drop queued frames down to the limit so incoming ones
+        // still find a free slot. dropped sequenced frames are not acked,
+        // the sender retransmits them
+        size_t depth = recv_queue_.size();
+        if (recv_drop_policy_ == RecvDrop_Oldest) {
+            for (; depth > recv_limit_; depth--) {
+                recv_queue_.pop();
+                recv_shed_++;
+            }
+            return;
+        }
+        if (recv_drop_policy_ != RecvDrop_Priority) {
+            return;
+        }
+
+        // frames are marked in place, the ones marked before still take a slot
+        size_t queued = 0;
+        for (size_t idx = 0; idx < depth; idx++) {
+            queued += recv_queue_.peek(idx)->size != 0;
+        }
+        for (int priority = PRIORITY_LEN - 1; priority >= 0 && queued > recv_limit_; priority--) {
+            for (size_t idx = 0; idx < depth && queued > recv_limit_; idx++) {
+                recv_data_t *item = recv_queue_.peek(idx);
+                if (!item->size || get_command_priority(item->data.raw, item->size) != priority) {
+                    continue;
+                }
+                item->size = 0;
+                recv_shed_++;
+                queued--;
+            }
+        }
+
+    }
+
+    bool ESPNowProxy::send_nack_(ESPNowProxyPeer *peer) {
+
+        // gaps may have been filled in the meantime
+        peer->set_nack_pending(false);
+        seq_window_t *window = peer->get_rx_window(Space_Shared);
+        uint32_t nack_bitmap = seq_window_missing(window);
+        if (!nack_bitmap) {
+            return false;
+        }
+        PACKET_LOGD(
+            TAG, "Sending DataNack to %s (%d, 0x%08x)",
+            mac_str(peer->get_address()).c_str(),
+            window->highest,
+            nack_bitmap);
+        return send_command_data_nack(addr64_to_addr(peer->get_address()), window->highest, nack_bitmap);
+
+    }
+
+    void ESPNowProxy::on_nack_(const command_data_nack_t &nack, uint32_t current) {
+
+        // retransmit missed broadcasts still kept, a retransmission answers
+        // the nacks of all receivers missing the same packet
+        auto queue = get_send_queue();
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            send_data_t *item = *it;
+            if (
+                !(item->flags & COMMAND_FLAG_NACK) || !item->sent ||
+                (item->batch && item->batch != item) ||
+                !nack_covers(nack.packet_id_highest, nack.nack_bitmap, item->packet_id)
+            ) {
+                continue;
+            }
+            if ((int32_t)(current - item->tx_time) < (int32_t)min_retransmit_timeout_) {
+                continue;
+            }
+            PACKET_LOGD(TAG, "Retransmit nacked packet %d", item->packet_id);
+            TRACE(Trace_Nack, item->command, item->packet_id, item->address);
+            if (!transmit_(this, item)) {
+                break;
+            }
         }
-        // no match
-        return nullptr;
+
     }
 
-    // callback handler
+    void ESPNowProxy::schedule_ack_(ESPNowProxyPeer *peer, Seq_e seq, uint8_t flags) {
 
-    void ESPNowProxy::on_send_(const uint8_t *addr, esp_now_send_status_t status) {
+        // every sequenced frame passes here
+        link_stats_t *stats = peer->get_stats();
+        stats->received++;
+        if (seq == Seq_Duplicate) {
+            stats->duplicates++;
+        } else if (seq == Seq_OutOfOrder) {
+            stats->out_of_order++;
+        }
 
-        ESP_LOGD(TAG, "Message send status %d", status);
-    }
+        // broadcast without acks, with nacks only report gaps after a short
+        // delay so reordered packets can still fill them
+        if (flags & COMMAND_FLAG_NO_ACK) {
+            if ((flags & COMMAND_FLAG_NACK) && !peer->is_nack_pending() && seq_window_missing(peer->get_rx_window(Space_Shared))) {
+                peer->set_nack_pending(true);
+                peer->set_nack_due(clock_millis() + ack_delay_);
+            }
+            return;
+        }
 
-    void ESPNowProxy::on_recv_(const uint8_t *addr, const uint8_t *data, int size) {
+        // batch acks, but answer right away on gaps and duplicates
+        uint8_t space = flags & COMMAND_FLAG_SHARED ? Space_Shared : Space_Peer;
+        if (!peer->get_ack_pending(space)) {
+            peer->set_ack_due(space, clock_millis() + ack_delay_);
+        }
+        peer->set_ack_pending(space, peer->get_ack_pending(space) + 1);
+        if (seq != Seq_New || !ack_delay_ || peer->get_ack_pending(space) >= ACK_MAX_PENDING) {
+            send_ack_(peer, space);
+        }
 
-        // create received data, this needs to be freed later
-        recv_data_t *received = (recv_data_t *)malloc(sizeof(recv_data_t));
-        memcpy((uint8_t *)received->data.raw, (uint8_t *)data, size);
-        memcpy((uint8_t *)received->addr, (uint8_t *)addr, MAC_ADDRESS_LEN);
-        received->size = size;
+    }
 
-        // add received data to queue
-        recv_queue_->push_back(received);
+    void ESPNowProxy::process_send_status_() {
+
+        // the receiver did not get the frame, no ack will come. retry after
+        // the minimum retransmit timeout instead of the estimated one
+        for (send_status_t *failed = send_status_.front(); failed; failed = send_status_.front()) {
+            ESPNowProxyBase *link = failed->command & COMMAND_FLAG_SHARED ? this : get_link_(failed->address);
+            link->get_stats()->send_failed++;
+            auto queue = link->get_send_queue();
+            for (auto it = queue->begin(); it != queue->end(); ++it) {
+                send_data_t *item = *it;
+                if (item->retries > 0 && item->packet_id == failed->packet_id && item->address == failed->address) {
+                    item->rto = std::min(item->rto, min_retransmit_timeout_);
+                }
+            }
+            send_status_.pop();
+        }
 
     }
 
-    // public functions
+    bool ESPNowProxy::process_acks_() {
+
+        // send delayed acks that are due
+        uint32_t current = clock_millis();
+        bool processed = false;
+        for (auto peer : peers_) {
+            for (uint8_t space = 0; space < SPACE_LEN; space++) {
+                if (peer->get_ack_pending(space) && (int32_t)(current - peer->get_ack_due(space)) >= 0) {
+                    processed |= send_ack_(peer, space);
+                }
+            }
+            if (peer->is_nack_pending() && (int32_t)(current - peer->get_nack_due()) >= 0) {
+                send_nack_(peer);
+                processed = true;
+            }
+            // credit was low, tell the peer once the queue drained
+            if (peer->is_credit_low() && recv_credit_(peer->get_address()) >= recv_limit_ / 2) {
+                processed |= send_ack_(peer, peer->get_rx_window(Space_Peer)->valid ? Space_Peer : Space_Shared);
+            }
+        }
+        return processed;
 
-    bool ESPNowProxy::send(const char *data) {
+    }
 
-        ESP_LOGD(TAG, "Add send command to queue, queue size: %d", send_queue_->size());
-        if (send_queue_->size() >= MAX_SEND_QUEUE_LEN) {
-            ESP_LOGW(TAG, "Send command queue full, dropping command");
-            return false;
+    send_data_t *ESPNowProxy::alloc_send_(const send_options_t &options, uint8_t command) {
+
+        // every destination has its own bounded queue
+        mac_address_t address = options.address ? options.address : get_send_address_();
+        ESPNowProxyBase *link = get_link_(address);
+        auto queue = link->get_send_queue();
+        PACKET_LOGD(TAG, "Add send command to queue, queue size: %zu", queue->size());
+        if (queue->size() >= max_queue_length_) {
+            ESP_LOGW(TAG, "Send command queue for %s full, dropping command", mac_str(address).c_str());
+            TRACE(Trace_Drop, command, 0, address);
+            link->get_stats()->dropped++;
+            return nullptr;
         }
 
-        // create send data for later processing, this needs later to be freed
-        send_data_t *send = (send_data_t *)malloc(sizeof(send_data_t));
-        memcpy(send->data, data, MAX_PAYLOAD_LENGTH);
-        send->size = sizeof(data);
-        if (address_) {
-            send->address = address_;
-        } else {
-            send->address = addr_to_addr64(espnow_proxy_base::BROADCAST);
+        // a link with messages queued leaves a slot for every other link
+        // with an empty queue, so unreachable peers can't use up the pool
+        if (!queue->empty() && send_pool_.available() <= idle_links_(link)) {
+            ESP_LOGW(TAG, "Send pool reserved for other receivers, dropping command for %s", mac_str(address).c_str());
+            TRACE(Trace_Drop, command, 0, address);
+            link->get_stats()->dropped++;
+            return nullptr;
+        }
+
+        // take send data for later processing from pool, this needs later to be released
+        send_data_t *send = send_pool_.alloc();
+        if (!send) {
+            ESP_LOGW(TAG, "Send pool exhausted, dropping command");
+            link->get_stats()->dropped++;
+            return nullptr;
+        }
+        send->command = command;
+        send->flags = 0;
+        if (address == addr_to_addr64(espnow_proxy_base::BROADCAST) && broadcast_mode_ != BroadcastMode_Ack) {
+            send->flags = COMMAND_FLAG_NO_ACK | (broadcast_mode_ == BroadcastMode_Nack ? COMMAND_FLAG_NACK : 0);
         }
+        send->priority = std::min(options.priority, (uint8_t)(PRIORITY_LEN - 1));
+        send->size = 0;
+        send->address = address;
         send->time = 0;
+        send->tx_time = 0;
         send->retries = 0;
         send->packet_id = 0;
         send->sent = false;
+        send->delivery = 0;
+        send->key = command == Command_Data ? options.key : 0;
+        send->replaced = false;
+        send->batch = nullptr;
+        TRACE(Trace_Queue, command, 0, address);
 
-        // add send data to queue
-        send_queue_->push_back(send);
-
-        return true;
+        return send;
 
     }
 
-    bool ESPNowProxy::send(std::string data) {
-        return ESPNowProxy::send(data.c_str());
+    size_t ESPNowProxy::idle_links_(ESPNowProxyBase *link) {
+
+        // links other than the given one without queued messages
+        size_t idle = link != this && get_send_queue()->empty() ? 1 : 0;
+        for (auto peer : peers_) {
+            if (peer != link && peer->get_send_queue()->empty()) {
+                idle++;
+            }
+        }
+        return idle;
+
     }
 
-    void ESPNowProxy::setup() {
+    bool ESPNowProxy::queue_send_(send_data_t *message) {
 
-        // setup callbacks (send/recv)
-        espnow_proxy_base::add_send_callback(
-            [&](const uint8_t *addr, esp_now_send_status_t status) { on_send_(addr, status); }
-        );
-        espnow_proxy_base::add_recv_callback(
-            [&](const uint8_t *addr, const uint8_t *data, int size) { on_recv_(addr, data, size); }
-        );
+        // add send data to queue, behind messages of the same or a higher priority
+        ESPNowProxyBase *link = get_link_(message->address);
+        auto queue = link->get_send_queue();
+        auto it = queue->begin();
+        while (it != queue->end() && (*it)->priority <= message->priority) {
+            ++it;
+        }
+        message->queue_time = clock_millis();
+        if (!queue->insert(it, message)) {
+            complete_message_(message, Delivery_Dropped);
+            link->get_stats()->dropped++;
+            return false;
+        }
+        link->get_stats()->queue_high_water = std::max((uint32_t)queue->size(), link->get_stats()->queue_high_water);
+        wake_();
 
-        // prepare connection
-        setup_wifi_();
+        return true;
 
     }
 
-    void ESPNowProxy::loop() {
+    send_data_t *ESPNowProxy::enqueue_(const send_options_t &options, uint8_t command, const uint8_t *data, size_t size) {
 
-        if (!espnow_proxy_base::is_ready()) {
-            ESP_LOGD(TAG, "ESPNow not ready, trying to start in loop");
-            setup_wifi_();
-        } else if (espnow_proxy_base::is_sending()) {
-            return;
+        send_data_t *send = alloc_send_(options, command);
+        if (!send) {
+            return nullptr;
+        }
+        memcpy(send->data, data, size);
+        send->size = size;
+        if (!queue_send_(send)) {
+            return nullptr;
         }
 
-        pre_process_queues_();
-        if (process_recv_queue_()) {
-            return;
+        return send;
+
+    }
+
+    delivery_handle_t ESPNowProxy::send_data_(const uint8_t *data, size_t size, const send_options_t &options) {
+
+        send_data_t *message = options.key ? replace_keyed_(options) : nullptr;
+        if (message) {
+            memcpy(message->data, data, size);
+            message->size = size;
+            delivery_handle_t handle = open_delivery_(message->address, options.on_delivery);
+            message->delivery = handle.id;
+            return handle;
         }
-        if (process_send_queue_()) {
-            return;
+        message = alloc_send_(options, Command_Data);
+        if (!message) {
+            mac_address_t address = options.address ? options.address : get_send_address_();
+            report_delivery_(delivery_handle_t{}, address, Delivery_Dropped, options.on_delivery);
+            return delivery_handle_t{};
+        }
+        memcpy(message->data, data, size);
+        message->size = size;
+        delivery_handle_t handle = open_delivery_(message->address, options.on_delivery);
+        message->delivery = handle.id;
+        if (!queue_send_(message)) {
+            return delivery_handle_t{};
         }
 
+        return handle;
+
     }
 
-    void ESPNowProxy::dump_config() {
+    send_data_t *ESPNowProxy::replace_keyed_(const send_options_t &options) {
 
-        ESP_LOGCONFIG(TAG, "ESPNowProxy...");
-        ESP_LOGCONFIG(TAG, "  Connection State: %d", espnow_proxy_base::is_ready());
-        if (address_) {
-            ESP_LOGCONFIG(TAG, "  Receiver Address: %s", addr64_to_str(get_address()).c_str());
-        } else {
-            ESP_LOGCONFIG(TAG, "  Receiver Broadcast");
+        // only the latest value of a key is sent. one in flight is not sent
+        // again, an unsent one is returned to be overwritten in place and
+        // keeps its position. keyed messages are never batched
+        mac_address_t address = options.address ? options.address : get_send_address_();
+        ESPNowProxyBase *link = get_link_(address);
+        auto queue = link->get_send_queue();
+        auto found = queue->end();
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            send_data_t *item = *it;
+            if (item->key != options.key || item->address != address || item->replaced) {
+                continue;
+            }
+            if (!item->retries) {
+                found = it;
+                continue;
+            }
+            // unacked broadcasts are not retried anyway
+            if (!(item->flags & COMMAND_FLAG_NO_ACK)) {
+                PACKET_LOGD(TAG, "Packet %d with key %d replaced, no more retries", item->packet_id, item->key);
+                TRACE(Trace_Replace, item->command, item->packet_id, address);
+                link->get_stats()->replaced++;
+                item->replaced = true;
+            }
         }
-
-        // peers configured
-        ESP_LOGCONFIG(TAG, "  Peers:");
-        for (auto it = peers_.begin(); it != peers_.end(); ++it) {
-            mac_address_t address = it->first;
-            ESPNowProxyPeer* peer = it->second;
-            ESP_LOGCONFIG(
-                TAG, "    Peer %s - address: %s",
-                peer->get_name_prefix().c_str(),
-                addr64_to_str(peer->get_address()).c_str());
+        if (found == queue->end()) {
+            return nullptr;
         }
 
-        // esp now peers
-        esp_now_peer_num_t num_peers;
-        if (esp_now_get_peer_num(&num_peers) != ESP_OK) {
-            return;
-        }
-        esp_now_peer_info_t peers[num_peers.total_num];
-        int total = espnow_proxy_base::list_peers((esp_now_peer_info_t *)peers, num_peers.total_num);
-        ESP_LOGCONFIG(TAG, "  ESPNow Peers:");
-        for (auto idx = 0; idx < total; idx++) {
-            if (idx >= MAX_PEERS) {
-                break;
-            }
-            esp_now_peer_info_t peer = peers[idx];
-            mac_address_t address = espnow_proxy_base::addr_to_addr64(peer.peer_addr);
-            ESP_LOGCONFIG(
-                TAG, "    ESPNow Peer - address: %s - ifidx: %d%s",
-                addr_to_str(peer.peer_addr).c_str(),
-                peer.ifidx,
-                address_ == address ? " <- Receiver" : "");
+        send_data_t *queued = *found;
+        TRACE(Trace_Replace, queued->command, 0, address);
+        link->get_stats()->replaced++;
+        if (queued->priority != std::min(options.priority, (uint8_t)(PRIORITY_LEN - 1))) {
+            // queued by priority, the new value takes its own position
+            queue->erase(found);
+            complete_message_(queued, Delivery_Replaced);
+            return nullptr;
         }
-        ESP_LOGCONFIG(TAG, "    ... total (%d)", total);
+        close_delivery_(queued->delivery, Delivery_Replaced);
+
+        return queued;
 
     }
 
-    ESPNowProxyPeer *ESPNowProxy::set_peer(mac_address_t address) {
+    bool ESPNowProxy::key_in_flight_(ESPNowProxyBase *link, send_data_t *message) {
 
-        if (sizeof(peers_) < MAX_PEERS) {
-            ESP_LOGW(TAG, "Max peers already set");
+        auto queue = link->get_send_queue();
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            send_data_t *item = *it;
+            if (
+                item != message && item->key == message->key && item->address == message->address &&
+                item->retries > 0 && !((item->flags & COMMAND_FLAG_NO_ACK) && item->sent)
+            ) {
+                return true;
+            }
         }
-        auto peer = create_peer_(address);
-        peers_.emplace(address, peer);
 
-        return peer;
+        return false;
 
     }
 
-    //
-    // queues
-    //
-
-    void ESPNowProxy::pre_process_queues_() {
+    delivery_handle_t ESPNowProxy::send_fragmented_(const uint8_t *data, size_t size, const send_options_t &options) {
 
-        // check exisiting queue items for invalidity
-        uint32_t current = millis();
-        for (auto it = send_queue_->begin(); it != send_queue_->end();) {
-            send_data_t *item = *it;
-            bool keep = true;
+        mac_address_t address = options.address ? options.address : get_send_address_();
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+        if (size > MAX_MESSAGE_LEN) {
+            ESP_LOGW(TAG, "Message too large (%zu / %d), dropping command", size, MAX_MESSAGE_LEN);
+            report_delivery_(delivery_handle_t{}, address, Delivery_Dropped, options.on_delivery);
+            return delivery_handle_t{};
+        }
+        if (tx_stream_busy_()) {
+            ESP_LOGW(TAG, "Fragmented message still being sent, dropping command");
+            report_delivery_(delivery_handle_t{}, address, Delivery_Dropped, options.on_delivery);
+            return delivery_handle_t{};
+        }
 
-            // check for retries
-            if (item->retries >= MAX_SEND_RETRIES) {
+        // fragments are queued by process_streams_ as the window allows, the
+        // last one carries the handle
+        memcpy(tx_stream_buffer_, data, size);
+        tx_stream_len_ = size;
+        tx_stream_offset_ = 0;
+        tx_stream_message_id_++;
+        tx_stream_options_ = options;
+        tx_stream_options_.address = address;
+        tx_stream_options_.on_delivery = nullptr;
+        delivery_handle_t handle = open_delivery_(address, options.on_delivery);
+        tx_stream_delivery_ = handle.id;
+        PACKET_LOGD(TAG, "Add fragmented message %d (%zu bytes)", tx_stream_message_id_, size);
+        return handle;
+#else
+        ESP_LOGW(TAG, "Message too large (%zu / %zu), fragmentation disabled", size, MAX_PAYLOAD_LENGTH);
+        report_delivery_(delivery_handle_t{}, address, Delivery_Dropped, options.on_delivery);
+        return delivery_handle_t{};
+#endif
 
-                // too many retries, remove item from queue
-                ESP_LOGW(TAG, "Too many retries for sending to %s", addr64_to_str(item->address).c_str());
-                keep = false;
+    }
 
-            // check for timeout
-            } else if (item->time && current > item->time + SEND_TIMEOUT_MS) {
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+    bool ESPNowProxy::tx_stream_busy_() {
 
-                // timeout, remove item from queue
-                ESP_LOGW(
-                    TAG, "Timeout occurred waiting for send ack from %s queue size: %d (%d / %d)",
-                    addr64_to_str(item->address).c_str(),
-                    send_queue_->size(),
-                    current,
-                    item->time);
-                keep = false;
+        // receivers reassemble one message per sender at a time, a fragment
+        // of the previous one retransmitted after the next one started would
+        // abort both
+        if (tx_stream_offset_ < tx_stream_len_) {
+            return true;
+        }
+        auto queue = get_link_(tx_stream_options_.address)->get_send_queue();
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            if ((*it)->command == Command_Fragment) {
+                return true;
+            }
+        }
+        return false;
 
+    }
+#endif
+
+    bool ESPNowProxy::process_streams_() {
+
+        bool processed = false;
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+        // feed fragments of the outgoing message, at most a window at a time
+        auto queue = get_link_(tx_stream_options_.address)->get_send_queue();
+        size_t queued = 0;
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            if ((*it)->command == Command_Fragment) {
+                queued++;
             }
+        }
+        while (tx_stream_offset_ < tx_stream_len_ && queued < window_size_) {
+            uint8_t frame[MAX_PAYLOAD_LENGTH];
+            fragment_header_t *fragment = (fragment_header_t *)frame;
+            size_t size = std::min((size_t)MAX_FRAGMENT_LEN, tx_stream_len_ - tx_stream_offset_);
+            fragment->message_id = tx_stream_message_id_;
+            fragment->offset = tx_stream_offset_;
+            fragment->total_len = tx_stream_len_;
+            memcpy(frame + FRAGMENT_HEADER_LEN, tx_stream_buffer_ + tx_stream_offset_, size);
+            send_data_t *message = enqueue_(tx_stream_options_, Command_Fragment, frame, size + FRAGMENT_HEADER_LEN);
+            if (!message) {
+                break;
+            }
+            tx_stream_offset_ += size;
+            if (tx_stream_offset_ == tx_stream_len_) {
+                message->delivery = tx_stream_delivery_;
+                tx_stream_delivery_ = 0;
+            }
+            queued++;
+            processed = true;
+        }
+
+        // give up on incoming messages that stopped
+        uint32_t current = clock_millis();
+        for (auto peer : peers_) {
+            reassembly_.expire(peer->get_rx_stream(), current, reassembly_timeout_, [&](const stream_chunk_t &chunk) {
+                on_stream_chunk_(peer, chunk);
+            });
+        }
+#endif
+        return processed;
 
-            // decide what to do with item
-            if (!keep) {
+    }
 
-                // do not keep item in queue, free
-                it = send_queue_->erase(it);
-                free(item);
+    bool ESPNowProxy::prepare_batch_(ESPNowProxyBase *link, send_data_t *leader, uint32_t current) {
 
-            } else {
+        // collect new messages to the same destination that fit into one frame
+        auto queue = link->get_send_queue();
+        size_t size = BATCH_RECORD_HEADER_LEN + leader->size;
+        size_t count = 0;
+        bool full = false;
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            send_data_t *item = *it;
+            if (
+                item == leader || item->retries > 0 || item->batch || item->key || item->flags != leader->flags ||
+                item->command != Command_Data || item->address != leader->address
+            ) {
+                continue;
+            }
+            if (size + BATCH_RECORD_HEADER_LEN + item->size > MAX_PAYLOAD_LENGTH) {
+                full = true;
+                break;
+            }
+            size += BATCH_RECORD_HEADER_LEN + item->size;
+            count++;
+        }
 
-                // keep item in queue
-                ++it;
+        // hold back until the frame is full or the linger time passed
+        if (!full && current - leader->queue_time < batch_linger_) {
+            return false;
+        }
+        if (!count) {
+            return true;
+        }
 
+        // mark the messages packed into the leaders frame
+        leader->batch = leader;
+        for (auto it = queue->begin(); count && it != queue->end(); ++it) {
+            send_data_t *item = *it;
+            if (
+                item == leader || item->retries > 0 || item->batch || item->key || item->flags != leader->flags ||
+                item->command != Command_Data || item->address != leader->address
+            ) {
+                continue;
             }
+            item->batch = leader;
+            count--;
         }
+        return true;
 
     }
 
-    bool ESPNowProxy::process_send_queue_() {
-        if (send_queue_->empty()) {
-            return false;
-        }
+    uint8_t ESPNowProxy::pack_batch_(ESPNowProxyBase *link, send_data_t *leader, uint8_t *frame) {
 
-        // get message that was not sent yet from queue
-        send_data_t *message = nullptr;
-        for (auto it = send_queue_->begin(); it != send_queue_->end(); ) {
+        auto queue = link->get_send_queue();
+        size_t size = 0;
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
             send_data_t *item = *it;
-            if (!item->sent) {
-                it = send_queue_->erase(it);
-                message = item;
-                break;
+            if (item->batch != leader) {
+                continue;
             }
-            ++it;
+            frame[size] = item->size;
+            memcpy(frame + size + BATCH_RECORD_HEADER_LEN, item->data, item->size);
+            size += BATCH_RECORD_HEADER_LEN + item->size;
+
+            // packed messages share the state of the frame
+            item->packet_id = leader->packet_id;
+            item->time = leader->time;
+            item->tx_time = leader->tx_time;
+            item->retries = leader->retries;
         }
+        return size;
 
-        if (!message) {
-            return false;
+    }
+
+    uint32_t ESPNowProxy::retransmit_timeout_for_(send_data_t *message) {
+
+        // estimated from the link, configured value until the first ack arrived
+        rtt_estimator_t *rtt = get_link_(message->address)->get_rtt();
+        uint32_t timeout = rtt->valid ? rtt->rto : retransmit_timeout_;
+
+        // exponential backoff per attempt, jitter keeps peers from retrying in sync
+        uint8_t shift = std::min((uint8_t)(message->retries - 1), (uint8_t)RTO_BACKOFF_MAX_SHIFT);
+        timeout = std::min(timeout << shift, max_retransmit_timeout_);
+        return timeout + clock_random() % (timeout / 4 + 1);
+
+    }
+
+    void ESPNowProxy::ack_message_(send_data_t *message, uint32_t current) {
+
+        // only first attempts give an unambiguous round trip time (karn)
+        ESPNowProxyBase *link = get_link_(message->address);
+        link_stats_t *stats = link->get_stats();
+        bool packed = message->batch && message->batch != message;
+        if (message->retries == 1 && message->sent && !packed) {
+            rtt_sample(link->get_rtt(), current - message->tx_time, min_retransmit_timeout_, max_retransmit_timeout_);
+            histogram_add(stats->rtt, current - message->tx_time);
+        }
+        stats->delivered++;
+        histogram_add(stats->latency, current - message->queue_time);
+        PACKET_LOGD(TAG, "Packet %d confirmed, message sent and confirmed", message->packet_id);
+        TRACE(Trace_Acked, message->command, message->packet_id, message->address);
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+        // fragments are acked out of order, the handle of a fragmented
+        // message moves on until its last outstanding fragment is acked
+        if (message->command == Command_Fragment && message->delivery) {
+            auto queue = link->get_send_queue();
+            for (auto it = queue->begin(); it != queue->end(); ++it) {
+                if ((*it)->command == Command_Fragment) {
+                    (*it)->delivery = message->delivery;
+                    message->delivery = 0;
+                    break;
+                }
+            }
         }
+#endif
+        complete_message_(message, Delivery_Acked);
+
+    }
+
+    bool ESPNowProxy::transmit_(ESPNowProxyBase *link, send_data_t *message) {
 
-        // a message was found, update send attempts
+        // update send attempts, packet id is kept for retransmissions
+        if (message->retries == 0) {
+            message->time = clock_millis();
+            message->packet_id = link->next_packet_id();
+            reserve_packet_id_(link);
+        }
+        if (message->retries > 0) {
+            link->get_stats()->retransmits++;
+        }
         message->retries++;
+        message->tx_time = clock_millis();
+        message->rto = retransmit_timeout_for_(message);
+        TRACE(message->retries == 1 ? Trace_Send : Trace_Retransmit, message->command, message->packet_id, message->address);
 
         // log message details
-        ESP_LOGD(TAG, "Using message %s: %s (%d / %d)", addr64_to_str(message->address).c_str(), message->data, message->retries, MAX_SEND_RETRIES);
+        PACKET_LOGD(
+            TAG, "Using message %s: %s (packet_id: %d, %d / %d)",
+            mac_str(message->address).c_str(),
+            message->data,
+            message->packet_id,
+            message->retries,
+            MAX_SEND_RETRIES);
 
         // send message
-        if (message->time == 0) {
-            message->time = millis();
+        notify_(Event_SendStarted, nullptr, nullptr, 0);
+
+        // receivers keep a window per sequence space, acked frames not sent
+        // on a peer link are marked as part of the shared one
+        uint8_t flags = message->flags;
+        if (link == this && !(flags & COMMAND_FLAG_NO_ACK)) {
+            flags |= COMMAND_FLAG_SHARED;
+        }
+
+        bool sent;
+        if (message->batch == message) {
+            uint8_t frame[MAX_PAYLOAD_LENGTH];
+            uint8_t size = pack_batch_(link, message, frame);
+            uint8_t command = Command_Batch | flags | (message->priority << COMMAND_PRIORITY_SHIFT);
+            sent = send_command(addr64_to_addr(message->address), command, frame, size, message->packet_id);
+        } else {
+            uint8_t command = message->command | flags | (message->priority << COMMAND_PRIORITY_SHIFT);
+            sent = send_command(addr64_to_addr(message->address), command, message->data, message->size, message->packet_id);
         }
-        message->packet_id = last_packet_id_;
-        this->on_send_started_callback.call();
 
-        if (send_command_data(addr64_to_addr(message->address), message->data, message->size, message->packet_id)) {
+        if (sent) {
 
-            ESP_LOGD(TAG, "Message sent successfully");
-            last_packet_id_++;
-            message->sent = true;
-            this->on_send_finished_callback.call();
+            PACKET_LOGD(TAG, "Message sent successfully");
+            notify_(Event_SendFinished, nullptr, nullptr, 0);
 
         } else {
 
             ESP_LOGW(TAG, "Message send failed");
-            message->sent = false;
-            this->on_send_failed_callback.call();
+            TRACE(Trace_SendFail, message->command, message->packet_id, message->address);
+            notify_(Event_SendFailed, nullptr, nullptr, 0);
 
         }
-        send_queue_->push_back(message);
 
-        return true;
+        // packed messages follow the state of their frame
+        auto queue = link->get_send_queue();
+        for (auto it = queue->begin(); message->batch && it != queue->end(); ++it) {
+            if ((*it)->batch == message) {
+                (*it)->sent = sent;
+            }
+        }
+        message->sent = sent;
+
+        return message->sent;
+
+    }
+
+    bool ESPNowProxy::process_link_queue_(ESPNowProxyBase *link, uint8_t priority, uint32_t current, bool *blocked) {
+
+        // send messages of one priority while the deficit of the link allows
+        auto queue = link->get_send_queue();
+        bool pending = false;
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            send_data_t *item = *it;
+
+            // queue is ordered by priority
+            if (item->priority < priority) {
+                continue;
+            }
+            if (item->priority > priority) {
+                break;
+            }
+
+            // packed into another frame, sent together with its leader
+            if (item->batch && item->batch != item) {
+                continue;
+            }
+
+            if (item->retries > 0) {
+
+                // unacked broadcasts are only sent again on nacks
+                if ((item->flags & COMMAND_FLAG_NO_ACK) && item->sent) {
+                    continue;
+                }
+
+                // in flight or refused by the radio, wait for the timer of this
+                // attempt. signed, a frame sent after current was read is not due
+                if ((int32_t)(current - item->tx_time) < (int32_t)item->rto) {
+                    continue;
+                }
+                PACKET_LOGD(TAG, "Retransmit timeout for packet %d (%u ms)", item->packet_id, item->rto);
+
+            } else if (!window_open_(link, item->address)) {
+
+                // new message, but the window to this peer is full
+                continue;
+
+            } else if (item->key && key_in_flight_(link, item)) {
+
+                // an older value of the key is in flight, this one is
+                // replaced in place until it was acked or dropped
+                continue;
+
+            } else if (batching_ && item->command == Command_Data && !item->key && !prepare_batch_(link, item, current)) {
+
+                // waiting for more messages to fill the frame
+                continue;
+
+            }
+
+            // spend deficit, the rest waits for the next round
+            size_t cost = HEADER_LEN + (item->batch ? MAX_PAYLOAD_LENGTH : item->size);
+            if (cost > link->get_deficit()) {
+                pending = true;
+                break;
+            }
+            link->set_deficit(link->get_deficit() - cost);
+
+            if (!transmit_(link, item)) {
+                // radio did not accept the frame, try again next loop
+                *blocked = true;
+                return false;
+            }
+            pending = true;
+        }
+
+        // nothing left to send, deficit is not carried over
+        if (!pending) {
+            link->set_deficit(0);
+        }
+        return pending;
+
+    }
+
+    bool ESPNowProxy::process_send_queue_() {
+
+        // strict priority between classes, deficit round robin across peers
+        // within a class, so an unreachable peer does not hold back others
+        bool processed = false;
+        bool blocked = false;
+        size_t count = links_.size();
+        for (uint8_t priority = 0; priority < PRIORITY_LEN && !blocked; priority++) {
+            bool pending = true;
+            while (pending && !blocked) {
+                // time passes while sending, every pass compares against its own clock
+                uint32_t current = clock_millis();
+                pending = false;
+                for (size_t n = 0; n < count && !blocked; n++) {
+                    ESPNowProxyBase *link = links_[(next_link_ + n) % count];
+                    if (link->get_send_queue()->empty()) {
+                        continue;
+                    }
+                    link->set_deficit(link->get_deficit() + MAX_DATA_LEN);
+                    uint32_t sent = link->get_deficit();
+                    pending |= process_link_queue_(link, priority, current, &blocked);
+                    processed |= link->get_deficit() < sent;
+                }
+            }
+        }
+        if (count) {
+            next_link_ = (next_link_ + 1) % count;
+        }
+
+        return processed;
 
     }
 
     bool ESPNowProxy::process_recv_queue_() {
 
-        if (recv_queue_->size() == 0) {
+        if (recv_queue_.size() > recv_limit_) {
+            shed_recv_queue_();
+        }
+        recv_data_t *message = recv_queue_.front();
+        while (message && !message->size) {
+            // dropped on overload
+            recv_queue_.pop();
+            message = recv_queue_.front();
+        }
+        if (!message) {
             return false;
         }
 
-        recv_data_t *message = recv_queue_->front();
-        recv_queue_->pop_front();
-
         auto header = message->data.command_header;
         auto packet_id = header.packet_id;
 
@@ -324,27 +2178,33 @@ namespace espnow_proxy {
         auto peer = static_cast<ESPNowProxyPeer*>(get_peer_by_mac_address_(client_addr_a64));
 
         Command_e command = get_command(message->data.raw, message->size);
+        uint8_t flags = get_command_flags(message->data.raw, message->size);
+        TRACE(Trace_Recv, command, packet_id, client_addr_a64);
 
         // Log command details
-        ESP_LOGD(
-            TAG, "Recv command: 0x%02x, (size: %d), from: %s, peer: %s",
+        PACKET_LOGD(
+            TAG, "Recv command: 0x%02x, (size: %zu), from: %s, peer: %s",
             command,
             message->size,
-            addr_to_str(message->addr).c_str(),
+            mac_str(message->addr).c_str(),
             peer ? peer->get_name_prefix().c_str() : "<unknown>");
 
 
         // only if peer is found continue
         if (!peer) {
             ESP_LOGW(TAG, "Peer not found, ignoring command");
-            free(message);
+            recv_queue_.pop();
             return true;
         }
 
         // use peer address for responses
         auto peer_addr_a64 = peer->get_address();
-        on_packet_data_callback.call(peer_addr_a64, message->data);
-        peer->on_packet_data_callback.call(peer_addr_a64, message->data);
+
+        // the sender has a sequence space for us as configured peer and one
+        // shared by broadcasts and destinations that are not its peers
+        uint8_t space = flags & (COMMAND_FLAG_NO_ACK | COMMAND_FLAG_SHARED) ? Space_Shared : Space_Peer;
+        seq_window_t *window = peer->get_rx_window(space);
+        notify_(Event_PacketData, peer, message->data.raw, message->size);
 
         // process command received
         switch (command) {
@@ -354,43 +2214,200 @@ namespace espnow_proxy {
             case Command_Data:
                 {
                     command_data_t command_data = message->data.command_data;
-                    ESP_LOGD(TAG, "Received Data from %s: %s", addr_to_str(message->addr).c_str(), (char *)command_data.data);
-                    const std::string data = (char *)command_data.data;
-                    on_command_data_callback.call(peer_addr_a64, data);
-                    peer->on_command_data_callback.call(peer_addr_a64, data);
-                    ESP_LOGD(TAG, "Sending DataAck to %s (%d)", addr64_to_str(peer->get_address()).c_str(), packet_id);
-                    send_command_data_ack(addr64_to_addr(peer->get_address()), packet_id, message->data.command_header.packet_id);
+                    PACKET_LOGD(TAG, "Received Data from %s: %s (%d)", mac_str(message->addr).c_str(), (char *)command_data.data, packet_id);
+                    Seq_e seq = seq_window_check(window, packet_id);
+                    if (seq == Seq_Duplicate) {
+                        // retransmission of a delivered packet, the ack got lost
+                        PACKET_LOGD(TAG, "Duplicate packet %d, not delivered", packet_id);
+                        TRACE(Trace_Duplicate, command, packet_id, client_addr_a64);
+                    } else {
+                        TRACE(Trace_Deliver, command, packet_id, client_addr_a64);
+                        dispatch_command_data_(peer, command_data.data, message->size - HEADER_LEN);
+                    }
+
+                    schedule_ack_(peer, seq, flags);
+                }
+                break;
+
+            case Command_Batch:
+                {
+                    PACKET_LOGD(TAG, "Received Batch from %s (%d)", mac_str(message->addr).c_str(), packet_id);
+                    Seq_e seq = seq_window_check(window, packet_id);
+                    if (seq == Seq_Duplicate) {
+                        PACKET_LOGD(TAG, "Duplicate packet %d, not delivered", packet_id);
+                        TRACE(Trace_Duplicate, command, packet_id, client_addr_a64);
+                    } else {
+                        TRACE(Trace_Deliver, command, packet_id, client_addr_a64);
+                        // unpack records, each one is delivered as its own command
+                        const uint8_t *records = message->data.command_data.data;
+                        size_t size = message->size - HEADER_LEN;
+                        for (size_t pos = 0; pos + BATCH_RECORD_HEADER_LEN <= size; ) {
+                            uint8_t record_size = records[pos];
+                            pos += BATCH_RECORD_HEADER_LEN;
+                            if (pos + record_size > size) {
+                                ESP_LOGW(TAG, "Malformed batch record, ignoring rest of frame");
+                                break;
+                            }
+                            dispatch_command_data_(peer, records + pos, record_size);
+                            pos += record_size;
+                        }
+                    }
+
+                    schedule_ack_(peer, seq, flags);
+                }
+                break;
+
+            case Command_Fragment:
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+                if (message->size > HEADER_LEN + FRAGMENT_HEADER_LEN) {
+                    command_fragment_t *command_fragment = &message->data.command_fragment;
+                    uint8_t size = message->size - HEADER_LEN - FRAGMENT_HEADER_LEN;
+                    PACKET_LOGD(
+                        TAG, "Received Fragment from %s message: %d (%d + %d / %d) (%d)",
+                        mac_str(message->addr).c_str(),
+                        command_fragment->fragment.message_id,
+                        command_fragment->fragment.offset,
+                        size,
+                        command_fragment->fragment.total_len,
+                        packet_id);
+                    Seq_e seq = seq_window_check(window, packet_id, false);
+                    if (seq != Seq_Duplicate) {
+                        if (!reassembly_.can_accept(peer->get_rx_stream(), command_fragment->fragment)) {
+                            // no ack, the sender retransmits once slots are free again
+                            ESP_LOGW(TAG, "No reassembly slot free, ignoring fragment");
+                            break;
+                        }
+                        seq_window_check(window, packet_id);
+                        reassembly_.push(
+                            peer->get_rx_stream(), command_fragment->fragment, command_fragment->data, size, clock_millis(),
+                            [&](const stream_chunk_t &chunk) { on_stream_chunk_(peer, chunk); });
+                    }
+                    schedule_ack_(peer, seq, flags);
+                }
+#endif
+                break;
+
+            case Command_Request:
+                if (message->size >= HEADER_LEN + RPC_HEADER_LEN) {
+                    PACKET_LOGD(TAG, "Received Request from %s (%d)", mac_str(message->addr).c_str(), packet_id);
+                    Seq_e seq = seq_window_check(window, packet_id);
+                    if (seq == Seq_Duplicate) {
+                        // still being answered or the response is on its way,
+                        // a plain ack stops the retransmissions
+                        TRACE(Trace_Duplicate, command, packet_id, client_addr_a64);
+                        schedule_ack_(peer, seq, flags);
+                        break;
+                    }
+                    TRACE(Trace_Deliver, command, packet_id, client_addr_a64);
+                    // a response queued within the ack delay acks the request
+                    // and takes back the delayed ack, a slow handler still
+                    // gets the request acked and does not cost retransmissions
+                    schedule_ack_(peer, seq, flags);
+                    notify_(Event_RpcRequest, peer, message->data.raw, message->size);
+                }
+                break;
+
+            case Command_Response:
+                if (message->size >= HEADER_LEN + RPC_HEADER_LEN) {
+                    rpc_header_t header;
+                    memcpy(&header, message->data.command_data.data, RPC_HEADER_LEN);
+                    PACKET_LOGD(
+                        TAG, "Received Response from %s request: %d status: %d (%d)",
+                        mac_str(message->addr).c_str(),
+                        header.request_id,
+                        header.status,
+                        packet_id);
+                    Seq_e seq = seq_window_check(window, packet_id);
+                    if (seq == Seq_Duplicate) {
+                        TRACE(Trace_Duplicate, command, packet_id, client_addr_a64);
+                    } else if (on_rpc_response_(peer_addr_a64, client_addr_a64, header, clock_millis())) {
+                        TRACE(Trace_Deliver, command, packet_id, client_addr_a64);
+                        notify_(Event_RpcResponse, peer, message->data.command_data.data, message->size - HEADER_LEN);
+                    }
+                    schedule_ack_(peer, seq, flags);
                 }
                 break;
 
             case Command_DataAck:
                 {
                     command_data_ack_t command_data_ack = message->data.command_data_ack;
-                    ESP_LOGD(TAG, "Received DataAck from %s packet_id: %d", addr_to_str(message->addr).c_str(), command_data_ack.packet_id_acked);
-                    for (auto it = send_queue_->begin(); it != send_queue_->end(); ) {
+                    PACKET_LOGD(TAG, "Received DataAck from %s packet_id: %d", mac_str(message->addr).c_str(), command_data_ack.packet_id_acked);
+                    // the message was queued for the peer or in the shared space for the receiver / broadcast
+                    ESPNowProxyBase *link = flags & COMMAND_FLAG_SHARED ? this : get_link_(peer_addr_a64);
+                    auto queue = link->get_send_queue();
+                    for (auto it = queue->begin(); it != queue->end(); ) {
                         send_data_t* item = *it;
-                        if (item->sent == true && item->packet_id == command_data_ack.packet_id_acked) {
+                        if (
+                            is_same_link_(item, peer_addr_a64, client_addr_a64) && item->retries > 0 &&
+                            !(item->flags & COMMAND_FLAG_NO_ACK) && item->packet_id == command_data_ack.packet_id_acked
+                        ) {
                             // packet confirmed, sent message sent and confirmed
-                            ESP_LOGD(TAG, "Packet %d confirmed, message sent and confirmed", command_data_ack.packet_id_acked);
-                            it = send_queue_->erase(it);
-                            free(item);
+                            queue->erase(it);
+                            ack_message_(item, clock_millis());
                             break;
 
                         } else {
 
                             // not the packet id, next item
-                            ESP_LOGD(TAG, "Packet %d (%d) not confirmed, next item", command_data_ack.packet_id_acked, item->packet_id);
                             ++it;
                         }
                     }
                 }
                 break;
 
+            case Command_DataSack:
+                {
+                    command_data_sack_t command_data_sack = message->data.command_data_sack;
+                    PACKET_LOGD(
+                        TAG, "Received DataSack from %s packet_id: %d (0x%08x)",
+                        mac_str(message->addr).c_str(),
+                        command_data_sack.packet_id_acked,
+                        command_data_sack.sack_bitmap);
+
+                    // credit of the receiver, not sent by nodes without flow control
+                    uint32_t current = clock_millis();
+                    if (message->size >= sizeof(command_data_sack_t)) {
+                        ESPNowProxyBase *link = get_link_(peer_addr_a64);
+                        link->set_credit(command_data_sack.credit, current);
+                    }
+
+                    // release every message covered by the ack in one pass, only
+                    // from the sequence space it was sent for
+                    ESPNowProxyBase *link = flags & COMMAND_FLAG_SHARED ? this : get_link_(peer_addr_a64);
+                    auto queue = link->get_send_queue();
+                    for (auto it = queue->begin(); it != queue->end(); ) {
+                        send_data_t* item = *it;
+                        if (
+                            item->retries > 0 && !(item->flags & COMMAND_FLAG_NO_ACK) &&
+                            is_same_link_(item, peer_addr_a64, client_addr_a64) &&
+                            sack_covers(command_data_sack.packet_id_acked, command_data_sack.sack_bitmap, item->packet_id)
+                        ) {
+                            it = queue->erase(it);
+                            ack_message_(item, current);
+                        } else {
+                            ++it;
+                        }
+                    }
+                }
+                break;
+
+            case Command_DataNack:
+                {
+                    command_data_nack_t command_data_nack = message->data.command_data_nack;
+                    PACKET_LOGD(
+                        TAG, "Received DataNack from %s packet_id: %d (0x%08x)",
+                        mac_str(message->addr).c_str(),
+                        command_data_nack.packet_id_highest,
+                        command_data_nack.nack_bitmap);
+                    on_nack_(command_data_nack, clock_millis());
+                }
+                break;
+
         }
 
-        // free recv message
-        ESP_LOGD(TAG, "Freeing recv message");
-        free(message);
+        // release recv slot
+        PACKET_LOGD(TAG, "Releasing recv message");
+        recv_queue_.pop();
         return true;
 
     }
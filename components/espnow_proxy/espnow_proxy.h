@@ -1,39 +1,61 @@
 #pragma once
 
 #include <vector>
-#include <map>
-#include <deque>
+#include <algorithm>
+#include <string_view>
 
 #include "esphome/core/log.h"
 #include "esphome/core/defines.h"
 #include "esphome/core/helpers.h"
 #include "esphome/core/component.h"
 #include "esphome/core/automation.h"
+#include "esphome/core/preferences.h"
+
+#ifdef USE_ESPNOW_PROXY_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#endif
 
 #include "base.h"
+#include "ring.h"
+#include "pool.h"
+#include "fragment.h"
+#include "peer_table.h"
+#include "rpc.h"
+#include "trace.h"
 
 namespace esphome {
 namespace espnow_proxy {
 
     using namespace espnow_proxy_base;
 
+    // received data is borrowed from the receive slot and only valid during
+    // the callback
     class EventTarget {
 
         public:
-            CallbackManager<void(const mac_address_t, const packet_data_t)> on_packet_data_callback;
-            CallbackManager<void(const mac_address_t, const std::string)> on_command_data_callback;
+            CallbackManager<void(const mac_address_t, const packet_data_t &)> on_packet_data_callback;
+            CallbackManager<void(const mac_address_t, std::string_view)> on_command_data_callback;
+            CallbackManager<void(const mac_address_t, const stream_chunk_t)> on_stream_data_callback;
             CallbackManager<void()> on_send_started_callback;
             CallbackManager<void()> on_send_finished_callback;
             CallbackManager<void()> on_send_failed_callback;
+            CallbackManager<void(const mac_address_t, uint32_t, uint8_t)> on_delivery_callback;
+            CallbackManager<void(const mac_address_t, uint8_t, uint8_t, std::string_view)> on_rpc_response_callback;
 
-            void add_on_packet_data_callback(std::function<void(const mac_address_t, const packet_data_t)> callback) {
+            void add_on_packet_data_callback(std::function<void(const mac_address_t, const packet_data_t &)> callback) {
                 on_packet_data_callback.add(std::move(callback));
             }
 
-            void add_on_command_data_callback(std::function<void(const mac_address_t, const std::string)> callback) {
+            void add_on_command_data_callback(std::function<void(const mac_address_t, std::string_view)> callback) {
                 on_command_data_callback.add(std::move(callback));
             }
 
+            void add_on_stream_data_callback(std::function<void(const mac_address_t, const stream_chunk_t)> callback) {
+                on_stream_data_callback.add(std::move(callback));
+            }
+
             void add_on_send_started_callback(std::function<void()> callback) {
                 on_send_started_callback.add(std::move(callback));
             }
@@ -45,6 +67,16 @@ namespace espnow_proxy {
             void add_on_send_failed_callback(std::function<void()> callback) {
                 on_send_failed_callback.add(std::move(callback));
             }
+
+            // final status of every tracked message, with its handle id
+            void add_on_delivery_callback(std::function<void(const mac_address_t, uint32_t, uint8_t)> callback) {
+                on_delivery_callback.add(std::move(callback));
+            }
+
+            // every finished call with method, status and response data
+            void add_on_rpc_response_callback(std::function<void(const mac_address_t, uint8_t, uint8_t, std::string_view)> callback) {
+                on_rpc_response_callback.add(std::move(callback));
+            }
     };
 
     class ESPNowProxyBase: public Component, public EventTarget {
@@ -53,8 +85,61 @@ namespace espnow_proxy {
             mac_address_t get_address() { return address_; };
             void set_address(mac_address_t address) { address_ = address; };
 
+            // link state, sequence space per destination
+            uint16_t next_packet_id() { return last_packet_id_++; };
+            uint16_t peek_packet_id() { return last_packet_id_; };
+            void set_packet_id(uint16_t value) { last_packet_id_ = value; };
+            // packet ids up to this one are covered by the persisted state
+            uint16_t get_packet_id_reserved() { return packet_id_reserved_; };
+            void set_packet_id_reserved(uint16_t value) { packet_id_reserved_ = value; };
+            // received packets of each sequence space of the peer (Space_e)
+            seq_window_t *get_rx_window(uint8_t space=Space_Peer) { return &rx_window_[space]; };
+            rtt_estimator_t *get_rtt() { return &rtt_; };
+            link_stats_t *get_stats() { return &stats_; };
+
+            // flow control, credit advertised by the peer for frames we send
+            uint8_t get_credit() { return credit_; };
+            uint32_t get_credit_time() { return credit_time_; };
+            void set_credit(uint8_t value, uint32_t time) { credit_ = value; credit_time_ = time; };
+            // we advertised the peer a low credit and owe it an update
+            bool is_credit_low() { return credit_low_; };
+            void set_credit_low(bool value) { credit_low_ = value; };
+
+            // delayed acks
+            uint8_t get_ack_pending(uint8_t space) { return ack_pending_[space]; };
+            void set_ack_pending(uint8_t space, uint8_t value) { ack_pending_[space] = value; };
+            uint32_t get_ack_due(uint8_t space) { return ack_due_[space]; };
+            void set_ack_due(uint8_t space, uint32_t value) { ack_due_[space] = value; };
+            bool is_nack_pending() { return nack_pending_; };
+            void set_nack_pending(bool value) { nack_pending_ = value; };
+            uint32_t get_nack_due() { return nack_due_; };
+            void set_nack_due(uint32_t value) { nack_due_ = value; };
+
+            // message reassembly
+            rx_stream_t *get_rx_stream() { return &rx_stream_; };
+
+            // send queue, ordered by priority, drained round robin across links
+            StaticQueue<send_data_t *, SEND_POOL_LEN> *get_send_queue() { return &send_queue_; };
+            uint32_t get_deficit() { return deficit_; };
+            void set_deficit(uint32_t value) { deficit_ = value; };
+
         protected:
             mac_address_t address_{0};
+            uint16_t last_packet_id_{0};
+            uint16_t packet_id_reserved_{0};
+            seq_window_t rx_window_[SPACE_LEN]{};
+            rtt_estimator_t rtt_{};
+            link_stats_t stats_{};
+            uint8_t credit_{CREDIT_UNKNOWN};
+            uint32_t credit_time_{0};
+            bool credit_low_{false};
+            uint8_t ack_pending_[SPACE_LEN]{};
+            uint32_t ack_due_[SPACE_LEN]{};
+            bool nack_pending_{false};
+            uint32_t nack_due_{0};
+            rx_stream_t rx_stream_{};
+            StaticQueue<send_data_t *, SEND_POOL_LEN> send_queue_;
+            uint32_t deficit_{0};
     };
 
     class ESPNowProxyPeer: public ESPNowProxyBase {
@@ -70,22 +155,216 @@ namespace espnow_proxy {
 
     };
 
+    typedef enum {
+        Event_PacketData = 0x00,
+        Event_CommandData = 0x01,
+        Event_StreamData = 0x02,
+        Event_SendStarted = 0x03,
+        Event_SendFinished = 0x04,
+        Event_SendFailed = 0x05,
+        Event_RpcRequest = 0x06,
+        Event_RpcResponse = 0x07,
+    } Event_e;
+
+    // failed completion of a sequenced frame, handed from the wifi task to
+    // the protocol. a power of two, when full the retry waits for its timeout
+    #ifndef SEND_STATUS_LEN
+    #define SEND_STATUS_LEN 8
+    #endif
+
+    struct send_status_t {
+        mac_address_t address;
+        uint8_t command;  // with flags
+        uint16_t packet_id;
+    };
+
+#ifdef USE_ESPNOW_PROXY_TASK
+    // callback marshalled from the protocol task to the main loop, data is
+    // copied since the task releases the receive slot right away
+    struct event_data_t {
+        uint8_t type;
+        ESPNowProxyPeer *peer;
+        stream_chunk_t chunk;
+        size_t size;
+        packet_data_t data;
+    };
+
+    // protocol state is shared between the protocol task and callers on the
+    // main loop, the lock is recursive since public functions nest
+    class ProtocolLock {
+
+        public:
+            explicit ProtocolLock(SemaphoreHandle_t mutex) : mutex_(mutex) {
+                if (mutex_) {
+                    xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+                }
+            }
+            ~ProtocolLock() {
+                if (mutex_) {
+                    xSemaphoreGiveRecursive(mutex_);
+                }
+            }
+
+        private:
+            SemaphoreHandle_t mutex_;
+    };
+
+    #define PROTOCOL_LOCK() ProtocolLock protocol_lock(mutex_)
+#else
+    #define PROTOCOL_LOCK()
+#endif
+
+    // link state kept in preferences, restored on boot so packet ids continue
+    // and peers are registered before the first send
+    #define PERSIST_FLAG_SOFTAP 0x01  // peer answers from its softAP address
+    // peers kept, set from the number of configured peers
+    #ifndef PERSIST_PEER_LEN
+    #define PERSIST_PEER_LEN MAX_PEERS
+    #endif
+
+    typedef struct __attribute__((packed)) {
+        mac_address_t address;
+        uint16_t packet_id;  // first packet id safe to use after a restart
+        uint8_t channel;
+        uint8_t ifidx;
+        uint8_t flags;
+    } persist_peer_t;
+
+    typedef struct __attribute__((packed)) {
+        uint16_t packet_id;  // receiver / broadcast link
+        uint8_t count;
+        persist_peer_t peers[PERSIST_PEER_LEN];
+    } persist_state_t;
+
     class ESPNowProxy : public ESPNowProxyBase {
 
-        #define MAX_SEND_QUEUE_LEN 5
         #define MAX_SEND_RETRIES 10
+        #define ACK_MAX_PENDING 8
+        #define TASK_POLL_MS 5
 
         private:
-            // peers
-            std::map<mac_address_t, ESPNowProxyPeer *> peers_;
+            // peers, looked up by station or softap address
+            std::vector<ESPNowProxyPeer *> peers_;
+            PeerTable<ESPNowProxyPeer, PEER_TABLE_LEN> peer_table_;
 
-            //  queues
-            std::deque<recv_data_t *> *recv_queue_ = new std::deque<recv_data_t *>();
-            std::deque<send_data_t *> *send_queue_ = new std::deque<send_data_t *>();
-            std::deque<send_data_t *> *send_ack_queue_ = new std::deque<send_data_t *>();
+            // links with a send queue, the proxy itself (receiver / broadcast) first
+            std::vector<ESPNowProxyBase *> links_{this};
+            size_t next_link_{0};
 
-            // packet
-            uint8_t last_packet_id_{0};
+            //  queues
+            SPSCRing<recv_data_t, RECV_QUEUE_LEN> recv_queue_;
+            SPSCRing<send_status_t, SEND_STATUS_LEN> send_status_;
+            uint8_t max_queue_length_{5};
+
+            // receive overload, frames above the limit are dropped by policy,
+            // the slots below it not taken by other senders are their credit
+            bool flow_control_{true};
+            uint16_t recv_limit_{RECV_QUEUE_LEN};
+            uint8_t recv_drop_policy_{RecvDrop_Newest};
+            uint32_t recv_shed_{0};
+
+            // pools
+            Pool<send_data_t, SEND_POOL_LEN> send_pool_;
+
+            // delivery status by handle id, slots are reused after
+            // DELIVERY_LEN sends. callbacks run from loop(), never while a
+            // queue is processed
+            static_assert(DELIVERY_LEN > 0 && (DELIVERY_LEN & (DELIVERY_LEN - 1)) == 0, "DELIVERY_LEN must be a power of two");
+            struct delivery_t {
+                uint32_t id;
+                uint8_t status;
+                bool reported;
+                mac_address_t address;
+                delivery_callback_t callback;
+            };
+            delivery_t deliveries_[DELIVERY_LEN]{};
+            uint32_t last_delivery_{0};
+            bool deliveries_done_{false};
+
+            // rpc, outstanding calls by request id and methods by id
+            typedef enum {
+                RpcSlot_Free = 0x00,
+                RpcSlot_Pending = 0x01,
+                RpcSlot_Answered = 0x02,  // response waits for the main loop
+                RpcSlot_Failed = 0x03,  // request timed out or dropped, reported from the main loop
+            } RpcSlot_e;
+            struct rpc_pending_t {
+                uint8_t state;
+                uint16_t request_id;
+                uint8_t method;
+                uint8_t status;
+                mac_address_t address;
+                mac_address_t answered_by;  // peer the response came from
+                uint32_t time;
+                uint32_t deadline;
+                rpc_callback_t callback;
+            };
+            struct rpc_method_t {
+                bool used;
+                uint8_t method;
+                rpc_handler_t handler;
+                rpc_stats_t stats;
+            };
+            rpc_pending_t rpc_pending_[RPC_PENDING_LEN]{};
+            rpc_method_t rpc_methods_[RPC_METHOD_LEN]{};
+            uint16_t last_request_id_{0};
+            uint32_t rpc_timeout_{1000};
+
+            // transmit window
+            uint8_t window_size_{4};
+            uint32_t retransmit_timeout_{250};
+            uint32_t min_retransmit_timeout_{20};
+            uint32_t max_retransmit_timeout_{2000};
+
+            // acks
+            uint32_t ack_delay_{10};
+
+            // broadcast reliability, sent messages are kept for nacks
+            uint8_t broadcast_mode_{BroadcastMode_Ack};
+            uint32_t broadcast_history_{200};
+
+            // work per loop iteration
+            uint8_t loop_budget_messages_{8};
+            uint32_t loop_budget_time_{2000};
+            uint32_t loop_time_{0};
+            uint32_t loop_time_max_{0};
+            uint32_t loop_budget_exhausted_{0};
+
+            // frame coalescing
+            bool batching_{false};
+            uint32_t batch_linger_{10};
+
+            // persisted link state, packet ids are reserved ahead so flash
+            // is only written every persist_reserve_ packets per link
+            bool persist_{false};
+            uint16_t persist_reserve_{256};
+            bool persist_dirty_{false};
+            ESPPreferenceObject persist_pref_;
+
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+            // fragmentation, one outgoing message at a time
+            uint8_t tx_stream_buffer_[MAX_MESSAGE_LEN];
+            size_t tx_stream_len_{0};
+            size_t tx_stream_offset_{0};
+            uint16_t tx_stream_message_id_{0};
+            send_options_t tx_stream_options_{};
+            uint32_t tx_stream_delivery_{0};  // handed to the last fragment
+            Reassembly<FRAGMENT_POOL_LEN> reassembly_;
+            uint32_t reassembly_timeout_{5000};
+#endif
+
+#ifdef USE_ESPNOW_PROXY_TASK
+            // protocol task, callbacks are dispatched on the main loop
+            TaskHandle_t task_{nullptr};
+            SemaphoreHandle_t mutex_{nullptr};
+            uint8_t task_priority_{5};
+            int8_t task_core_{1};
+            uint32_t task_stack_size_{4096};
+            SPSCRing<event_data_t, EVENT_QUEUE_LEN> event_queue_;
+
+            static void task_loop_(void *arg);
+            void process_events_();
+#endif
 
             // basic functions
             void setup_wifi_();
@@ -93,24 +372,149 @@ namespace espnow_proxy {
             // peers functions
             ESPNowProxyPeer *create_peer_(const mac_address_t address);
             ESPNowProxyPeer *get_peer_by_mac_address_(const mac_address_t address);
+            ESPNowProxyBase *get_link_(const mac_address_t address);
 
             // send / recv functions
-            void on_send_(const uint8_t *addr, esp_now_send_status_t status);
+            void on_send_(const uint8_t *addr, uint8_t status, const packet_data_t *frame);
             void on_recv_(const uint8_t *addr, const uint8_t *data, int size);
 
         public:
-            bool send(const char *data);
-            bool send(std::string data);
+            // the handle is valid once the message is queued, its final status
+            // is passed to options.on_delivery (dropped right away if not queued)
+            delivery_handle_t send(const char *data);
+            delivery_handle_t send(const std::string &data);
+            delivery_handle_t send(const char *data, const send_options_t &options);
+            delivery_handle_t send(const std::string &data, const send_options_t &options);
+            delivery_handle_t send(const uint8_t *data, size_t size, const send_options_t &options = send_options_t{});
+
+            // write the payload in place: reserve a pooled message, fill up to
+            // MAX_PAYLOAD_LENGTH bytes of its data, then commit or cancel it
+            send_data_t *reserve_send(const send_options_t &options = send_options_t{});
+            delivery_handle_t commit_send(send_data_t *message, size_t size);
+            void cancel_send(send_data_t *message);
+            // Delivery_e, Delivery_Unknown once the slot was reused
+            uint8_t get_delivery_status(delivery_handle_t handle);
+
+            // call a method at address (0: receiver), the callback gets the
+            // final status and the response. returns the request id, 0 if
+            // the request was not queued. timeout 0 uses the configured one
+            uint16_t call(
+                mac_address_t address, uint8_t method, const uint8_t *data, size_t size, rpc_callback_t callback,
+                uint32_t timeout=0);
+            uint16_t call(mac_address_t address, uint8_t method, const std::string &data, rpc_callback_t callback, uint32_t timeout=0);
+            // handler of requests to method, it answers with respond(), right
+            // away or later
+            bool register_method(uint8_t method, rpc_handler_t handler);
+            bool respond(const rpc_request_t &request, const uint8_t *data, size_t size, uint8_t status=Rpc_Ok);
+            bool respond(const rpc_request_t &request, const std::string &data, uint8_t status=Rpc_Ok);
+            // nullptr if the method was never used
+            const rpc_stats_t *get_rpc_stats(uint8_t method);
+            // copies taken under the protocol lock, for readers outside of the
+            // protocol task. false if the method was never used
+            void copy_link_stats(mac_address_t address, link_stats_t *stats, rtt_estimator_t *rtt);
+            bool copy_rpc_stats(uint8_t method, rpc_stats_t *stats);
+            void set_rpc_timeout(uint32_t value) { rpc_timeout_ = value; };
             void setup() override;
+            void on_shutdown() override;
             void loop() override;
             void dump_config() override;
+            // log the binary trace, needs trace_size
+            void dump_trace();
             float get_setup_priority() const override { return setup_priority::WIFI; }
             ESPNowProxyPeer *set_peer(mac_address_t address);
+            ESPNowProxyBase *get_link(mac_address_t address) { return get_link_(address); };
+            void set_max_queue_length(uint8_t value) { max_queue_length_ = value; };
+            void set_window_size(uint8_t value) { window_size_ = value; };
+            void set_retransmit_timeout(uint32_t value) { retransmit_timeout_ = value; };
+            void set_min_retransmit_timeout(uint32_t value) { min_retransmit_timeout_ = value; };
+            void set_max_retransmit_timeout(uint32_t value) { max_retransmit_timeout_ = value; };
+            void set_ack_delay(uint32_t value) { ack_delay_ = value; };
+            void set_broadcast_mode(uint8_t value) { broadcast_mode_ = value; };
+            void set_broadcast_history(uint32_t value) { broadcast_history_ = value; };
+            void set_loop_budget_messages(uint8_t value) { loop_budget_messages_ = value; };
+            void set_loop_budget_time(uint32_t value) { loop_budget_time_ = value; };
+            void set_batching(bool value) { batching_ = value; };
+            void set_flow_control(bool value) { flow_control_ = value; };
+            void set_recv_limit(uint16_t value) { recv_limit_ = std::min<uint16_t>(value, RECV_QUEUE_LEN); };
+            void set_recv_drop_policy(uint8_t value) { recv_drop_policy_ = value; };
+            void set_persist_state(bool value) { persist_ = value; };
+            void set_persist_reserve(uint16_t value) { persist_reserve_ = value; };
+
+            // statistics, loop times in us
+            uint32_t get_loop_time() { return loop_time_; };
+            uint32_t get_loop_time_max() { return loop_time_max_; };
+            uint32_t get_loop_budget_exhausted() { return loop_budget_exhausted_; };
+            size_t get_recv_queue_depth() { return recv_queue_.size(); };
+            // frames dropped on overload, incoming (newest) and queued ones
+            uint32_t get_recv_dropped() { return recv_queue_.get_overflow() + recv_shed_; };
+            size_t get_send_queue_depth() { return send_pool_.in_use(); };
+            void set_batch_linger(uint32_t value) { batch_linger_ = value; };
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+            void set_reassembly_timeout(uint32_t value) { reassembly_timeout_ = value; };
+#endif
+#ifdef USE_ESPNOW_PROXY_TASK
+            void set_task_priority(uint8_t value) { task_priority_ = value; };
+            void set_task_core(int8_t value) { task_core_ = value; };
+            void set_task_stack_size(uint32_t value) { task_stack_size_ = value; };
+#endif
 
         protected:
+            bool process_protocol_();
+            void notify_(uint8_t event, ESPNowProxyPeer *peer, const uint8_t *data, size_t size, const stream_chunk_t *chunk=nullptr);
+            void call_(uint8_t event, ESPNowProxyPeer *peer, const uint8_t *data, size_t size, const stream_chunk_t *chunk);
+            void wake_();
             void pre_process_queues_();
             bool process_recv_queue_();
+            void shed_recv_queue_();
+            uint8_t recv_credit_(mac_address_t address);
             bool process_send_queue_();
+            bool process_acks_();
+            void process_send_status_();
+            bool process_streams_();
+#ifdef USE_ESPNOW_PROXY_FRAGMENTATION
+            bool tx_stream_busy_();
+#endif
+            mac_address_t get_send_address_();
+            bool process_link_queue_(ESPNowProxyBase *link, uint8_t priority, uint32_t current, bool *blocked);
+            send_data_t *enqueue_(const send_options_t &options, uint8_t command, const uint8_t *data, size_t size);
+            send_data_t *alloc_send_(const send_options_t &options, uint8_t command);
+            size_t idle_links_(ESPNowProxyBase *link);
+            bool queue_send_(send_data_t *message);
+            delivery_handle_t send_data_(const uint8_t *data, size_t size, const send_options_t &options);
+            send_data_t *replace_keyed_(const send_options_t &options);
+            bool key_in_flight_(ESPNowProxyBase *link, send_data_t *message);
+            delivery_handle_t send_fragmented_(const uint8_t *data, size_t size, const send_options_t &options);
+            delivery_handle_t open_delivery_(mac_address_t address, const delivery_callback_t &callback);
+            void close_delivery_(uint32_t id, uint8_t status);
+            void complete_message_(send_data_t *message, uint8_t status);
+            void report_delivery_(delivery_handle_t handle, mac_address_t address, uint8_t status, const delivery_callback_t &callback);
+            void process_deliveries_();
+            rpc_method_t *get_rpc_method_(uint8_t method, bool create);
+            send_data_t *take_request_(mac_address_t peer_address, mac_address_t sender_address, uint16_t request_id);
+            bool on_rpc_response_(
+                mac_address_t peer_address, mac_address_t sender_address, const rpc_header_t &header, uint32_t current);
+            void fail_rpc_(send_data_t *request);
+            void report_rpc_(
+                mac_address_t address, uint8_t method, uint8_t status, std::string_view data, const rpc_callback_t &callback);
+            void dispatch_rpc_request_(ESPNowProxyPeer *peer, const uint8_t *data, size_t size);
+            void dispatch_rpc_response_(ESPNowProxyPeer *peer, const uint8_t *data, size_t size);
+            void process_rpc_();
+            void on_stream_chunk_(ESPNowProxyPeer *peer, const stream_chunk_t &chunk);
+            void schedule_ack_(ESPNowProxyPeer *peer, Seq_e seq, uint8_t flags);
+            bool window_open_(ESPNowProxyBase *link, const mac_address_t address);
+            bool transmit_(ESPNowProxyBase *link, send_data_t *message);
+            uint32_t retransmit_timeout_for_(send_data_t *message);
+            void ack_message_(send_data_t *message, uint32_t current);
+            bool prepare_batch_(ESPNowProxyBase *link, send_data_t *leader, uint32_t current);
+            uint8_t pack_batch_(ESPNowProxyBase *link, send_data_t *leader, uint8_t *frame);
+            void dispatch_command_data_(ESPNowProxyPeer *peer, const uint8_t *data, size_t size);
+            bool send_ack_(ESPNowProxyPeer *peer, uint8_t space);
+            bool send_nack_(ESPNowProxyPeer *peer);
+            void on_nack_(const command_data_nack_t &nack, uint32_t current);
+            bool is_same_link_(const send_data_t *item, const mac_address_t peer_address, const mac_address_t sender_address);
+            void restore_state_();
+            void save_state_(bool exact);
+            void reserve_packet_id_(ESPNowProxyBase *link);
 
     };
 
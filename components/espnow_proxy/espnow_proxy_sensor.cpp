@@ -0,0 +1,71 @@
+#include "espnow_proxy_sensor.h"
+
+#ifdef USE_SENSOR
+
+namespace esphome {
+namespace espnow_proxy {
+
+    static const char *const TAG = "espnow_proxy.sensor";
+
+    void ESPNowProxySensor::update() {
+
+        // copied under the protocol lock, the protocol task updates the
+        // stats while they are published
+        link_stats_t stats;
+        rtt_estimator_t rtt;
+        parent_->copy_link_stats(address_, &stats, &rtt);
+
+        publish_(delivered_, stats.delivered);
+        publish_(retransmits_, stats.retransmits);
+        publish_(timeouts_, stats.timeouts);
+        publish_(dropped_, stats.dropped);
+        publish_(replaced_, stats.replaced);
+        publish_(received_, stats.received);
+        publish_(duplicates_, stats.duplicates);
+        publish_(out_of_order_, stats.out_of_order);
+        publish_(queue_high_water_, stats.queue_high_water);
+        if (rtt.valid) {
+            publish_(rtt_, rtt.srtt8 >> 3);
+        }
+        publish_(rtt_p90_, histogram_percentile(stats.rtt, 90));
+        publish_(latency_p50_, histogram_percentile(stats.latency, 50));
+        publish_(latency_p90_, histogram_percentile(stats.latency, 90));
+
+        // method statistics exist once the method was called
+        rpc_stats_t rpc;
+        if (parent_->copy_rpc_stats(rpc_method_, &rpc)) {
+            publish_(rpc_calls_, rpc.calls);
+            publish_(rpc_errors_, rpc.errors);
+            publish_(rpc_timeouts_, rpc.timeouts);
+            publish_(rpc_latency_p50_, histogram_percentile(rpc.latency, 50));
+            publish_(rpc_latency_p90_, histogram_percentile(rpc.latency, 90));
+        }
+
+    }
+
+    void ESPNowProxySensor::dump_config() {
+
+        ESP_LOGCONFIG(TAG, "ESPNowProxy Sensor...");
+        if (address_) {
+            ESP_LOGCONFIG(TAG, "  Address: %s", mac_str(address_).c_str());
+        } else {
+            ESP_LOGCONFIG(TAG, "  Address: receiver");
+        }
+        if (rpc_calls_ || rpc_errors_ || rpc_timeouts_ || rpc_latency_p50_ || rpc_latency_p90_) {
+            ESP_LOGCONFIG(TAG, "  RPC Method: %d", rpc_method_);
+        }
+
+    }
+
+    void ESPNowProxySensor::publish_(sensor::Sensor *sensor, float value) {
+
+        if (sensor) {
+            sensor->publish_state(value);
+        }
+
+    }
+
+}  // namespace espnow_proxy
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_SENSOR
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+
+#include "espnow_proxy.h"
+
+namespace esphome {
+namespace espnow_proxy {
+
+    // publishes the statistics of one link, a configured peer or the
+    // receiver / broadcast link of the proxy
+    class ESPNowProxySensor : public PollingComponent, public Parented<ESPNowProxy> {
+
+        public:
+            void set_address(mac_address_t value) { address_ = value; };
+            void set_delivered_sensor(sensor::Sensor *value) { delivered_ = value; };
+            void set_retransmits_sensor(sensor::Sensor *value) { retransmits_ = value; };
+            void set_timeouts_sensor(sensor::Sensor *value) { timeouts_ = value; };
+            void set_dropped_sensor(sensor::Sensor *value) { dropped_ = value; };
+            void set_replaced_sensor(sensor::Sensor *value) { replaced_ = value; };
+            void set_received_sensor(sensor::Sensor *value) { received_ = value; };
+            void set_duplicates_sensor(sensor::Sensor *value) { duplicates_ = value; };
+            void set_out_of_order_sensor(sensor::Sensor *value) { out_of_order_ = value; };
+            void set_queue_high_water_sensor(sensor::Sensor *value) { queue_high_water_ = value; };
+            void set_rtt_sensor(sensor::Sensor *value) { rtt_ = value; };
+            void set_rtt_p90_sensor(sensor::Sensor *value) { rtt_p90_ = value; };
+            void set_latency_p50_sensor(sensor::Sensor *value) { latency_p50_ = value; };
+            void set_latency_p90_sensor(sensor::Sensor *value) { latency_p90_ = value; };
+            // calls of one rpc method
+            void set_rpc_method(uint8_t value) { rpc_method_ = value; };
+            void set_rpc_calls_sensor(sensor::Sensor *value) { rpc_calls_ = value; };
+            void set_rpc_errors_sensor(sensor::Sensor *value) { rpc_errors_ = value; };
+            void set_rpc_timeouts_sensor(sensor::Sensor *value) { rpc_timeouts_ = value; };
+            void set_rpc_latency_p50_sensor(sensor::Sensor *value) { rpc_latency_p50_ = value; };
+            void set_rpc_latency_p90_sensor(sensor::Sensor *value) { rpc_latency_p90_ = value; };
+
+            void update() override;
+            void dump_config() override;
+
+        protected:
+            mac_address_t address_{0};
+            sensor::Sensor *delivered_{nullptr};
+            sensor::Sensor *retransmits_{nullptr};
+            sensor::Sensor *timeouts_{nullptr};
+            sensor::Sensor *dropped_{nullptr};
+            sensor::Sensor *replaced_{nullptr};
+            sensor::Sensor *received_{nullptr};
+            sensor::Sensor *duplicates_{nullptr};
+            sensor::Sensor *out_of_order_{nullptr};
+            sensor::Sensor *queue_high_water_{nullptr};
+            sensor::Sensor *rtt_{nullptr};
+            sensor::Sensor *rtt_p90_{nullptr};
+            sensor::Sensor *latency_p50_{nullptr};
+            sensor::Sensor *latency_p90_{nullptr};
+            uint8_t rpc_method_{0};
+            sensor::Sensor *rpc_calls_{nullptr};
+            sensor::Sensor *rpc_errors_{nullptr};
+            sensor::Sensor *rpc_timeouts_{nullptr};
+            sensor::Sensor *rpc_latency_p50_{nullptr};
+            sensor::Sensor *rpc_latency_p90_{nullptr};
+
+            void publish_(sensor::Sensor *sensor, float value);
+    };
+
+}  // namespace espnow_proxy
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // chunk of a fragmented message handed to the consumer, data is borrowed
+    // and only valid during the callback
+    struct stream_chunk_t {
+        uint16_t message_id;
+        uint16_t offset;
+        uint16_t total_len;
+        const uint8_t *data;
+        uint8_t size;
+        bool last;
+        bool aborted;
+    };
+
+    // reassembly state of the message currently received from a peer
+    struct rx_stream_t {
+        bool active = false;
+        uint16_t message_id = 0;
+        uint16_t total_len = 0;
+        uint16_t next_offset = 0;
+        uint32_t time = 0;
+    };
+
+    // fragment received ahead of the stream position
+    struct fragment_slot_t {
+        rx_stream_t *stream;
+        uint16_t message_id;
+        uint16_t offset;
+        uint8_t size;
+        uint8_t data[MAX_FRAGMENT_LEN];
+    };
+
+    // Streaming reassembly of fragmented messages. Fragments are delivered as
+    // soon as they continue the stream, only fragments received out of order
+    // are held, in a fixed number of slots shared by all peers.
+    template<size_t N>
+    class Reassembly {
+
+        public:
+            // false if the fragment can not be taken right now, it must then
+            // not be acked so the sender retransmits it later
+            bool can_accept(const rx_stream_t *stream, const fragment_header_t &fragment) {
+                bool in_order = stream->active && stream->message_id == fragment.message_id
+                    ? fragment.offset <= stream->next_offset
+                    : fragment.offset == 0;
+                if (in_order || slots_.available() > 0) {
+                    return true;
+                }
+                rejected_++;
+                return false;
+            }
+
+            template<typename F>
+            void push(rx_stream_t *stream, const fragment_header_t &fragment, const uint8_t *data, uint8_t size, uint32_t time, F &&deliver) {
+
+                if (!size || fragment.offset + size > fragment.total_len) {
+                    return;
+                }
+
+                // a new message replaces an unfinished one
+                if (!stream->active || stream->message_id != fragment.message_id) {
+                    abort(stream, deliver);
+                    stream->active = true;
+                    stream->message_id = fragment.message_id;
+                    stream->total_len = fragment.total_len;
+                    stream->next_offset = 0;
+                }
+                stream->time = time;
+
+                // stale, already delivered
+                if (fragment.offset < stream->next_offset) {
+                    return;
+                }
+
+                // ahead of the stream, hold until the gap is filled
+                if (fragment.offset > stream->next_offset) {
+                    fragment_slot_t *slot = slots_.alloc();
+                    if (!slot) {
+                        return;
+                    }
+                    slot->stream = stream;
+                    slot->message_id = fragment.message_id;
+                    slot->offset = fragment.offset;
+                    slot->size = size;
+                    memcpy(slot->data, data, size);
+                    held_.push_back(slot);
+                    return;
+                }
+
+                // continues the stream, deliver it and everything held behind it
+                deliver_(stream, data, size, deliver);
+                for (auto it = held_.begin(); stream->active && it != held_.end(); ) {
+                    fragment_slot_t *slot = *it;
+                    if (slot->stream == stream && slot->offset == stream->next_offset) {
+                        held_.erase(it);
+                        deliver_(stream, slot->data, slot->size, deliver);
+                        slots_.release(slot);
+                        it = held_.begin();
+                    } else {
+                        ++it;
+                    }
+                }
+
+            }
+
+            // give up on an unfinished message, e.g. after a timeout
+            template<typename F>
+            void abort(rx_stream_t *stream, F &&deliver) {
+                if (!stream->active) {
+                    return;
+                }
+                release_(stream);
+                stream->active = false;
+                stream_chunk_t chunk{stream->message_id, stream->next_offset, stream->total_len, nullptr, 0, true, true};
+                deliver(chunk);
+            }
+
+            template<typename F>
+            void expire(rx_stream_t *stream, uint32_t time, uint32_t timeout, F &&deliver) {
+                if (stream->active && time - stream->time > timeout) {
+                    abort(stream, deliver);
+                }
+            }
+
+            size_t held() const { return slots_.in_use(); }
+            constexpr size_t capacity() const { return N; }
+            size_t get_high_water() const { return slots_.get_high_water(); }
+            uint32_t get_rejected() const { return rejected_; }
+
+        private:
+            Pool<fragment_slot_t, N> slots_;
+            StaticQueue<fragment_slot_t *, N> held_;
+            uint32_t rejected_{0};
+
+            template<typename F>
+            void deliver_(rx_stream_t *stream, const uint8_t *data, uint8_t size, F &&deliver) {
+                stream_chunk_t chunk{stream->message_id, stream->next_offset, stream->total_len, data, size, false, false};
+                stream->next_offset += size;
+                chunk.last = stream->next_offset >= stream->total_len;
+                if (chunk.last) {
+                    release_(stream);
+                    stream->active = false;
+                }
+                deliver(chunk);
+            }
+
+            void release_(rx_stream_t *stream) {
+                for (auto it = held_.begin(); it != held_.end(); ) {
+                    fragment_slot_t *slot = *it;
+                    if (slot->stream == stream) {
+                        it = held_.erase(it);
+                        slots_.release(slot);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+
+    };
+
+}  // namespace espnow_proxy_base
+}  // esphome
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // table capacity and hash multiplier, generated from the configured peers
+    // so every address lands in its own slot (perfect hash)
+    #ifndef PEER_TABLE_LEN
+    #define PEER_TABLE_LEN 32
+    #endif
+    #ifndef PEER_HASH_MULT
+    #define PEER_HASH_MULT 0x9E3779B97F4A7C15ULL
+    #endif
+
+    // softAP address of a device is its station address + 1 in the last byte
+    inline mac_address_t softap_alias(mac_address_t address) {
+        return (address & ~0xFFULL) | ((address + 1) & 0xFF);
+    }
+
+    // Flat open addressing table over mac addresses, no heap usage and no
+    // allocation on lookup. Every peer is stored with its station address
+    // and its softAP alias. Not thread safe, used from the main loop only.
+    template<typename T, size_t N>
+    class PeerTable {
+
+        static_assert(N > 0 && (N & (N - 1)) == 0, "PeerTable capacity must be a power of two");
+
+        public:
+            struct entry_t {
+                mac_address_t address;
+                T *value;
+                bool alias;
+                bool registered;  // alias added as esp now peer
+            };
+
+            bool insert(mac_address_t address, T *value) {
+                return insert_(address, value, false) && insert_(softap_alias(address), value, true);
+            }
+
+            entry_t *find(mac_address_t address) {
+                size_t index = slot_(address);
+                for (size_t n = 0; n < N; n++) {
+                    entry_t *entry = &entries_[(index + n) & (N - 1)];
+                    if (!entry->value || entry->address == address) {
+                        return entry->value ? entry : nullptr;
+                    }
+                }
+                return nullptr;
+            }
+
+            size_t size() const { return size_; }
+            constexpr size_t capacity() const { return N; }
+            uint32_t get_probes() const { return probes_; }
+
+        private:
+            entry_t entries_[N]{};
+            size_t size_{0};
+            uint32_t probes_{0};  // extra slots probed on insert, 0 if the hash is perfect
+
+            static constexpr size_t bits_() {
+                size_t bits = 0;
+                while ((1ULL << bits) < N) {
+                    bits++;
+                }
+                return bits;
+            }
+
+            static size_t slot_(mac_address_t address) {
+                if (N == 1) {
+                    return 0;
+                }
+                return (size_t)((address * PEER_HASH_MULT) >> (64 - bits_()));
+            }
+
+            bool insert_(mac_address_t address, T *value, bool alias) {
+                size_t index = slot_(address);
+                for (size_t n = 0; n < N; n++) {
+                    entry_t *entry = &entries_[(index + n) & (N - 1)];
+                    if (entry->value && entry->address != address) {
+                        continue;
+                    }
+                    // station addresses win over softAP aliases of other peers
+                    if (entry->value && alias && !entry->alias) {
+                        return true;
+                    }
+                    if (!entry->value) {
+                        size_++;
+                        probes_ += n;
+                    }
+                    *entry = entry_t{address, value, alias, false};
+                    return true;
+                }
+                return false;
+            }
+
+    };
+
+}  // namespace espnow_proxy_base
+}  // esphome
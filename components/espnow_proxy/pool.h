@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // Fixed capacity slab of preallocated objects, no heap usage after
+    // construction. Not thread safe, used from the main loop only.
+    template<typename T, size_t N>
+    class Pool {
+
+        public:
+            Pool() {
+                for (size_t i = 0; i < N; i++) {
+                    free_[i] = &slots_[N - 1 - i];
+                }
+                free_len_ = N;
+            }
+
+            T *alloc() {
+                if (free_len_ == 0) {
+                    exhausted_++;
+                    return nullptr;
+                }
+                T *item = free_[--free_len_];
+                if (in_use() > high_water_) {
+                    high_water_ = in_use();
+                }
+                return item;
+            }
+
+            void release(T *item) {
+                if (!item || free_len_ >= N) {
+                    return;
+                }
+                free_[free_len_++] = item;
+            }
+
+            size_t in_use() const { return N - free_len_; }
+            size_t available() const { return free_len_; }
+            constexpr size_t capacity() const { return N; }
+            size_t get_high_water() const { return high_water_; }
+            uint32_t get_exhausted() const { return exhausted_; }
+
+        private:
+            T slots_[N];
+            T *free_[N];
+            size_t free_len_{0};
+            size_t high_water_{0};
+            uint32_t exhausted_{0};
+
+    };
+
+    // Fixed capacity ordered queue with a deque like interface, used to hold
+    // pointers to pooled objects without allocating queue nodes.
+    template<typename T, size_t N>
+    class StaticQueue {
+
+        public:
+            using iterator = T *;
+
+            iterator begin() { return items_; }
+            iterator end() { return items_ + len_; }
+
+            T &front() { return items_[0]; }
+            size_t size() const { return len_; }
+            bool empty() const { return len_ == 0; }
+            bool full() const { return len_ >= N; }
+
+            bool push_back(T item) {
+                if (full()) {
+                    return false;
+                }
+                items_[len_++] = item;
+                return true;
+            }
+
+            void pop_front() {
+                erase(begin());
+            }
+
+            bool insert(iterator it, T item) {
+                if (full() || it < begin() || it > end()) {
+                    return false;
+                }
+                for (iterator next = end(); next != it; --next) {
+                    *next = *(next - 1);
+                }
+                *it = item;
+                len_++;
+                return true;
+            }
+
+            iterator erase(iterator it) {
+                if (it < begin() || it >= end()) {
+                    return end();
+                }
+                for (iterator next = it + 1; next != end(); ++next) {
+                    *(next - 1) = *next;
+                }
+                len_--;
+                return it;
+            }
+
+        private:
+            T items_[N];
+            size_t len_{0};
+
+    };
+
+}  // namespace espnow_proxy_base
+}  // esphome
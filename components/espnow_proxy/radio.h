@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // Thin radio and clock abstraction, everything the protocol needs from
+    // the platform. ESP-NOW on the device (radio_espnow.cpp), a simulated
+    // shared medium with a virtual clock on the host (radio_sim.cpp).
+
+    #define RADIO_IF_STA 0
+
+    typedef enum {
+        Radio_SendSuccess = 0x00,
+        Radio_SendFail = 0x01,
+    } RadioSendStatus_e;
+
+    struct radio_peer_t {
+        uint8_t addr[MAC_ADDRESS_LEN];
+        uint8_t channel;
+        uint8_t ifidx;
+    };
+
+    typedef void (*radio_send_handler_t)(const uint8_t *addr, uint8_t status);
+    typedef void (*radio_recv_handler_t)(const uint8_t *addr, const uint8_t *data, int size);
+
+    bool radio_init(radio_send_handler_t send_handler, radio_recv_handler_t recv_handler);
+    void radio_deinit();
+    bool radio_send(const uint8_t *dest, const uint8_t *data, size_t size);
+    bool radio_add_peer(const uint8_t *peer, uint8_t channel, uint8_t ifidx);
+    bool radio_has_peer(const uint8_t *peer);
+    bool radio_remove_peer(const uint8_t *peer);
+    int radio_list_peers(radio_peer_t *peers, int max_peers);
+
+    // node the calling code runs as, always 0 on the device
+    uint8_t radio_node();
+
+    uint32_t clock_millis();
+    uint32_t clock_micros();
+    uint32_t clock_random();
+
+}  // namespace espnow_proxy_base
+}  // esphome
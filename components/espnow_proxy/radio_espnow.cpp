@@ -0,0 +1,126 @@
+#include "esphome/core/defines.h"
+
+#ifndef USE_HOST
+
+#include <algorithm>
+#include <cstring>
+
+#include <esp_wifi.h>
+#include <esp_now.h>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include "radio.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    static const char *TAG = "espnow_proxy_base.radio";
+
+    static radio_send_handler_t send_handler_ = nullptr;
+    static radio_recv_handler_t recv_handler_ = nullptr;
+
+    // esp now callbacks, run on the wifi task
+
+    static void on_send_(const uint8_t *addr, esp_now_send_status_t status) {
+        if (send_handler_) {
+            send_handler_(addr, status == ESP_NOW_SEND_SUCCESS ? Radio_SendSuccess : Radio_SendFail);
+        }
+    }
+
+    static void on_recv_(const esp_now_recv_info_t *recv_info, const uint8_t *data, int size) {
+        // addr may be different then base address, see the link below for details.
+        // https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/misc_system_api.html
+        if (recv_handler_) {
+            recv_handler_(recv_info->src_addr, data, size);
+        }
+    }
+
+    // radio
+
+    bool radio_init(radio_send_handler_t send_handler, radio_recv_handler_t recv_handler) {
+        ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+        if (esp_now_init() != ESP_OK) {
+            return false;
+        }
+        send_handler_ = send_handler;
+        recv_handler_ = recv_handler;
+        ESP_ERROR_CHECK(esp_now_register_send_cb(on_send_));
+        ESP_ERROR_CHECK(esp_now_register_recv_cb(on_recv_));
+        return true;
+    }
+
+    void radio_deinit() {
+        ESP_LOGD(TAG, "Unregister callbacks");
+        esp_now_unregister_recv_cb();
+        esp_now_unregister_send_cb();
+        ESP_LOGD(TAG, "Deinit");
+        esp_now_deinit();
+    }
+
+    bool radio_send(const uint8_t *dest, const uint8_t *data, size_t size) {
+        return esp_now_send(dest, data, size) == ESP_OK;
+    }
+
+    bool radio_add_peer(const uint8_t *peer, uint8_t channel, uint8_t ifidx) {
+        esp_now_peer_info_t peer_info{};
+        std::copy_n(peer, MAC_ADDRESS_LEN, peer_info.peer_addr);
+        peer_info.channel = channel;
+        peer_info.ifidx = static_cast<wifi_interface_t>(ifidx);
+
+        if (esp_now_is_peer_exist(peer)) {
+            return esp_now_mod_peer(&peer_info) == ESP_OK;
+        }
+        return esp_now_add_peer(&peer_info) == ESP_OK;
+    }
+
+    bool radio_has_peer(const uint8_t *peer) {
+        return esp_now_is_peer_exist(peer);
+    }
+
+    bool radio_remove_peer(const uint8_t *peer) {
+        return esp_now_del_peer(peer) == ESP_OK;
+    }
+
+    int radio_list_peers(radio_peer_t *peers, int max_peers) {
+        int total = 0;
+        esp_now_peer_info_t peer;
+        for (
+            esp_err_t e = esp_now_fetch_peer(true, &peer);
+            e == ESP_OK;
+            e = esp_now_fetch_peer(false, &peer)
+        ) {
+            if (total < max_peers) {
+                memcpy(peers[total].addr, peer.peer_addr, MAC_ADDRESS_LEN);
+                peers[total].channel = peer.channel;
+                peers[total].ifidx = peer.ifidx;
+            }
+            ++total;
+        }
+        return total;
+    }
+
+    uint8_t radio_node() {
+        return 0;
+    }
+
+    // clock
+
+    uint32_t clock_millis() {
+        return millis();
+    }
+
+    uint32_t clock_micros() {
+        return micros();
+    }
+
+    uint32_t clock_random() {
+        return random_uint32();
+    }
+
+}  // namespace espnow_proxy_base
+}  // namespace esphome
+
+#endif
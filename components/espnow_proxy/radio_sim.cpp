@@ -0,0 +1,332 @@
+#include "esphome/core/defines.h"
+
+#ifdef USE_HOST
+
+#include <algorithm>
+#include <cstring>
+
+#include "radio_sim.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    static const uint8_t BROADCAST_ADDR[MAC_ADDRESS_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+    SimMedium &SimMedium::get() {
+
+        static SimMedium medium;
+        return medium;
+
+    }
+
+    void SimMedium::configure(const sim_config_t &config) {
+
+        config_ = config;
+        random_ = config.seed ? config.seed : 1;
+
+    }
+
+    uint8_t SimMedium::add_node(mac_address_t address) {
+
+        if (nodes_.size() >= RADIO_NODE_LEN) {
+            return nodes_.size() - 1;
+        }
+        nodes_.push_back(node_t{address, false, nullptr, nullptr, {}});
+        return nodes_.size() - 1;
+
+    }
+
+    void SimMedium::select(uint8_t node) {
+
+        if (node < nodes_.size()) {
+            selected_ = node;
+        }
+
+    }
+
+    void SimMedium::advance(uint32_t us) {
+
+        uint64_t until = now_ + us;
+        uint8_t selected = selected_;
+        while (!events_.empty() && events_.front().time <= until) {
+            event_t event = events_.front();
+            events_.erase(events_.begin());
+            // the clock may have moved past the event already
+            now_ = std::max(now_, event.time);
+            node_t *node = &nodes_[event.node];
+            if (!node->ready) {
+                continue;
+            }
+            // handlers run as the node the event belongs to
+            selected_ = event.node;
+            if (event.type == SimEvent_Recv && node->recv_handler) {
+                stats_.delivered++;
+                node->recv_handler(event.addr, event.data, event.size);
+            } else if (event.type == SimEvent_SendStatus && node->send_handler) {
+                node->send_handler(event.addr, event.status);
+            }
+        }
+        now_ = std::max(now_, until);
+        selected_ = selected;
+
+    }
+
+    uint64_t SimMedium::read_clock() {
+
+        now_ += config_.clock_step;
+        return now_;
+
+    }
+
+    uint32_t SimMedium::random() {
+
+        // xorshift32, deterministic from the configured seed
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return random_;
+
+    }
+
+    uint8_t SimMedium::get_utilization() const {
+
+        if (!now_) {
+            return 0;
+        }
+        return std::min<uint64_t>(stats_.airtime * 100 / now_, 100);
+
+    }
+
+    bool SimMedium::init(radio_send_handler_t send_handler, radio_recv_handler_t recv_handler) {
+
+        node_t *node = node_();
+        if (!node) {
+            return false;
+        }
+        node->send_handler = send_handler;
+        node->recv_handler = recv_handler;
+        node->ready = true;
+        return true;
+
+    }
+
+    void SimMedium::deinit() {
+
+        node_t *node = node_();
+        if (node) {
+            node->ready = false;
+            node->peers.clear();
+        }
+
+    }
+
+    bool SimMedium::send(const uint8_t *dest, const uint8_t *data, size_t size) {
+
+        node_t *node = node_();
+        if (!node || !node->ready || size > MAX_DATA_LEN || !has_peer(dest)) {
+            return false;
+        }
+
+        // frames queue up on the medium, one at a time
+        uint32_t airtime = config_.bitrate ? config_.overhead + (uint64_t)size * 8 * 1000000 / config_.bitrate : 0;
+        uint64_t start = std::max(now_, busy_until_);
+        busy_until_ = start + airtime;
+        stats_.sent++;
+        stats_.airtime += airtime;
+
+        // dest may point to the shared addr64_to_addr buffer, read it first
+        mac_address_t address = addr_to_addr64(dest);
+        bool broadcast = memcmp(dest, BROADCAST_ADDR, MAC_ADDRESS_LEN) == 0;
+        bool delivered = false;
+        event_t event{};
+        event.type = SimEvent_Recv;
+        for (auto i = 0; i < MAC_ADDRESS_LEN; i++) {
+            event.addr[i] = (node->address >> (8 * (MAC_ADDRESS_LEN - 1 - i))) & 0xFF;
+        }
+        memcpy(event.data, data, size);
+        event.size = size;
+        for (size_t idx = 0; idx < nodes_.size(); idx++) {
+            if (idx == selected_ || !nodes_[idx].ready) {
+                continue;
+            }
+            if (!broadcast && nodes_[idx].address != address) {
+                continue;
+            }
+            if (chance_(config_.loss_percent)) {
+                stats_.lost++;
+                continue;
+            }
+            delivered = true;
+            event.node = idx;
+            event.time = busy_until_ + config_.latency + (config_.jitter ? random() % (config_.jitter + 1) : 0);
+            schedule_(event);
+            if (chance_(config_.duplicate_percent)) {
+                stats_.duplicated++;
+                event.time += airtime + config_.latency;
+                schedule_(event);
+            }
+        }
+
+        // the mac layer acks unicast frames, broadcast always succeeds
+        event_t status{};
+        status.type = SimEvent_SendStatus;
+        status.node = selected_;
+        status.time = busy_until_;
+        status.status = broadcast || delivered ? Radio_SendSuccess : Radio_SendFail;
+        for (auto i = 0; i < MAC_ADDRESS_LEN; i++) {
+            status.addr[i] = (address >> (8 * (MAC_ADDRESS_LEN - 1 - i))) & 0xFF;
+        }
+        schedule_(status);
+        return true;
+
+    }
+
+    bool SimMedium::add_peer(const uint8_t *peer, uint8_t channel, uint8_t ifidx) {
+
+        node_t *node = node_();
+        if (!node) {
+            return false;
+        }
+        radio_peer_t info{};
+        memcpy(info.addr, peer, MAC_ADDRESS_LEN);
+        info.channel = channel;
+        info.ifidx = ifidx;
+        for (auto &item : node->peers) {
+            if (memcmp(item.addr, peer, MAC_ADDRESS_LEN) == 0) {
+                item = info;
+                return true;
+            }
+        }
+        if (node->peers.size() >= RADIO_PEER_LEN) {
+            return false;
+        }
+        node->peers.push_back(info);
+        return true;
+
+    }
+
+    bool SimMedium::has_peer(const uint8_t *peer) {
+
+        node_t *node = node_();
+        if (!node) {
+            return false;
+        }
+        for (auto &item : node->peers) {
+            if (memcmp(item.addr, peer, MAC_ADDRESS_LEN) == 0) {
+                return true;
+            }
+        }
+        return false;
+
+    }
+
+    bool SimMedium::remove_peer(const uint8_t *peer) {
+
+        node_t *node = node_();
+        if (!node) {
+            return false;
+        }
+        for (auto it = node->peers.begin(); it != node->peers.end(); ++it) {
+            if (memcmp(it->addr, peer, MAC_ADDRESS_LEN) == 0) {
+                node->peers.erase(it);
+                return true;
+            }
+        }
+        return false;
+
+    }
+
+    int SimMedium::list_peers(radio_peer_t *peers, int max_peers) {
+
+        node_t *node = node_();
+        if (!node) {
+            return 0;
+        }
+        int total = 0;
+        for (auto &item : node->peers) {
+            if (total < max_peers) {
+                peers[total] = item;
+            }
+            ++total;
+        }
+        return total;
+
+    }
+
+    SimMedium::node_t *SimMedium::node_() {
+
+        return selected_ < nodes_.size() ? &nodes_[selected_] : nullptr;
+
+    }
+
+    bool SimMedium::chance_(uint8_t percent) {
+
+        return percent && random() % 100 < percent;
+
+    }
+
+    void SimMedium::schedule_(const event_t &event) {
+
+        event_t item = event;
+        item.seq = seq_++;
+        auto it = std::upper_bound(
+            events_.begin(), events_.end(), item,
+            [](const event_t &a, const event_t &b) {
+                return a.time < b.time || (a.time == b.time && a.seq < b.seq);
+            });
+        events_.insert(it, item);
+
+    }
+
+    // radio
+
+    bool radio_init(radio_send_handler_t send_handler, radio_recv_handler_t recv_handler) {
+        return SimMedium::get().init(send_handler, recv_handler);
+    }
+
+    void radio_deinit() {
+        SimMedium::get().deinit();
+    }
+
+    bool radio_send(const uint8_t *dest, const uint8_t *data, size_t size) {
+        return SimMedium::get().send(dest, data, size);
+    }
+
+    bool radio_add_peer(const uint8_t *peer, uint8_t channel, uint8_t ifidx) {
+        return SimMedium::get().add_peer(peer, channel, ifidx);
+    }
+
+    bool radio_has_peer(const uint8_t *peer) {
+        return SimMedium::get().has_peer(peer);
+    }
+
+    bool radio_remove_peer(const uint8_t *peer) {
+        return SimMedium::get().remove_peer(peer);
+    }
+
+    int radio_list_peers(radio_peer_t *peers, int max_peers) {
+        return SimMedium::get().list_peers(peers, max_peers);
+    }
+
+    uint8_t radio_node() {
+        return SimMedium::get().selected();
+    }
+
+    // clock, virtual time of the medium
+
+    uint32_t clock_millis() {
+        return SimMedium::get().read_clock() / 1000;
+    }
+
+    uint32_t clock_micros() {
+        return SimMedium::get().read_clock();
+    }
+
+    uint32_t clock_random() {
+        return SimMedium::get().random();
+    }
+
+}  // namespace espnow_proxy_base
+}  // namespace esphome
+
+#endif
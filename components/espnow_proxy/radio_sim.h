@@ -0,0 +1,124 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HOST
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "radio.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // channel model of the simulated medium, percentages per frame and receiver
+    struct sim_config_t {
+        uint8_t loss_percent = 0;
+        uint8_t duplicate_percent = 0;
+        uint32_t latency = 100;  // us from end of airtime to delivery
+        uint32_t jitter = 0;  // us, uniform 0..jitter added to the latency
+        uint32_t bitrate = 1000000;  // bit/s, 0: no airtime
+        uint32_t overhead = 100;  // us per frame, preamble and mac header
+        uint32_t seed = 1;
+        uint32_t clock_step = 0;  // us the clock moves on every read, time spent in the code
+    };
+
+    struct sim_stats_t {
+        uint32_t sent = 0;  // frames put on the medium
+        uint32_t lost = 0;  // per receiver
+        uint32_t duplicated = 0;
+        uint32_t delivered = 0;
+        uint64_t airtime = 0;  // us the medium was busy
+    };
+
+    // Shared medium for N virtual nodes in one process with a virtual clock.
+    // Every node runs its own ESPNowProxy, the driver selects a node before
+    // calling into it and advances the clock in between:
+    //
+    //   sim.select(0); proxy_a->loop();
+    //   sim.select(1); proxy_b->loop();
+    //   sim.advance(1000);
+    //
+    // Frames are delivered from advance() with the destination node selected.
+    // Same seed and same driver give the same run.
+    class SimMedium {
+
+        public:
+            static SimMedium &get();
+
+            void configure(const sim_config_t &config);
+            const sim_config_t &get_config() const { return config_; }
+            uint8_t add_node(mac_address_t address);
+            void select(uint8_t node);
+            uint8_t selected() const { return selected_; }
+            size_t size() const { return nodes_.size(); }
+
+            // run all frames due until now + us
+            void advance(uint32_t us);
+            uint64_t now() const { return now_; }
+            // now, moved on by the configured clock step
+            uint64_t read_clock();
+            uint32_t random();
+
+            const sim_stats_t &get_stats() const { return stats_; }
+            // share of the elapsed time the medium was busy, 0..100
+            uint8_t get_utilization() const;
+
+            // radio of the selected node
+            bool init(radio_send_handler_t send_handler, radio_recv_handler_t recv_handler);
+            void deinit();
+            bool send(const uint8_t *dest, const uint8_t *data, size_t size);
+            bool add_peer(const uint8_t *peer, uint8_t channel, uint8_t ifidx);
+            bool has_peer(const uint8_t *peer);
+            bool remove_peer(const uint8_t *peer);
+            int list_peers(radio_peer_t *peers, int max_peers);
+
+        protected:
+            struct node_t {
+                mac_address_t address;
+                bool ready;
+                radio_send_handler_t send_handler;
+                radio_recv_handler_t recv_handler;
+                std::vector<radio_peer_t> peers;
+            };
+
+            typedef enum {
+                SimEvent_Recv = 0x00,
+                SimEvent_SendStatus = 0x01,
+            } SimEvent_e;
+
+            struct event_t {
+                uint64_t time;
+                uint32_t seq;  // keeps events of the same time in order
+                uint8_t type;
+                uint8_t node;  // node the event is delivered to
+                uint8_t status;
+                uint8_t addr[MAC_ADDRESS_LEN];  // sender or destination
+                uint8_t data[MAX_DATA_LEN];
+                size_t size;
+            };
+
+            sim_config_t config_{};
+            sim_stats_t stats_{};
+            std::vector<node_t> nodes_;
+            std::vector<event_t> events_;  // sorted by time and seq
+            uint8_t selected_{0};
+            uint64_t now_{0};
+            uint64_t busy_until_{0};
+            uint32_t seq_{0};
+            uint32_t random_{1};
+
+            node_t *node_();
+            int find_node_(const uint8_t *addr);
+            bool chance_(uint8_t percent);
+            void schedule_(const event_t &event);
+
+    };
+
+}  // namespace espnow_proxy_base
+}  // esphome
+
+#endif
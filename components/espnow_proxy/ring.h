@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    #define CACHE_LINE_LEN 64
+
+    // Fixed capacity single-producer/single-consumer ring of preallocated slots.
+    //
+    // The producer (ESP-NOW receive callback, WiFi task) writes a slot in place
+    // between acquire() and commit(), the consumer (main loop) reads it in place
+    // between front() and pop(). Indexes are free running, the capacity must be a
+    // power of two.
+    template<typename T, size_t N>
+    class SPSCRing {
+
+        static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCRing capacity must be a power of two");
+
+        public:
+            // producer
+
+            // limit caps the depth below the capacity
+            T *acquire(size_t limit = N) {
+                uint32_t head = head_.load(std::memory_order_relaxed);
+                if (head - tail_.load(std::memory_order_acquire) >= limit) {
+                    overflow_.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                return &slots_[head & (N - 1)];
+            }
+
+            void commit() {
+                uint32_t head = head_.load(std::memory_order_relaxed) + 1;
+                head_.store(head, std::memory_order_release);
+                uint32_t depth = head - tail_.load(std::memory_order_acquire);
+                if (depth > high_water_.load(std::memory_order_relaxed)) {
+                    high_water_.store(depth, std::memory_order_relaxed);
+                }
+            }
+
+            // consumer
+
+            T *front() {
+                uint32_t tail = tail_.load(std::memory_order_relaxed);
+                if (tail == head_.load(std::memory_order_acquire)) {
+                    return nullptr;
+                }
+                return &slots_[tail & (N - 1)];
+            }
+
+            void pop() {
+                uint32_t tail = tail_.load(std::memory_order_relaxed) + 1;
+                tail_.store(tail, std::memory_order_release);
+            }
+
+            // slot index positions behind the front, committed slots belong
+            // to the consumer until popped
+            T *peek(size_t index) {
+                uint32_t tail = tail_.load(std::memory_order_relaxed);
+                if (index >= head_.load(std::memory_order_acquire) - tail) {
+                    return nullptr;
+                }
+                return &slots_[(tail + index) & (N - 1)];
+            }
+
+            // status
+
+            size_t size() const {
+                return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+            }
+
+            bool empty() const { return size() == 0; }
+            constexpr size_t capacity() const { return N; }
+            uint32_t get_overflow() const { return overflow_.load(std::memory_order_relaxed); }
+            uint32_t get_high_water() const { return high_water_.load(std::memory_order_relaxed); }
+
+        private:
+            // producer and consumer indexes live on separate cache lines
+            alignas(CACHE_LINE_LEN) std::atomic<uint32_t> head_{0};
+            std::atomic<uint32_t> overflow_{0};
+            std::atomic<uint32_t> high_water_{0};
+            alignas(CACHE_LINE_LEN) std::atomic<uint32_t> tail_{0};
+            alignas(CACHE_LINE_LEN) T slots_[N];
+
+    };
+
+}  // namespace espnow_proxy_base
+}  // esphome
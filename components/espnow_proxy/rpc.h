@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+
+#include "common.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // Request / response calls between nodes. A request is a sequenced
+    // message answered by the method registered at the receiver, its
+    // response carries the request id and also acks the request. The
+    // receiver acks it like data after the ack delay as well, so a slow
+    // handler does not make the caller retransmit. Outstanding requests
+    // wait in a table until the response from the called node arrives,
+    // their deadline passes or the request times out at the link.
+
+    // outstanding requests and methods with handlers or statistics,
+    // overridden from yaml (rpc: max_pending / max_methods)
+    #ifndef RPC_PENDING_LEN
+    #define RPC_PENDING_LEN 8
+    #endif
+    #ifndef RPC_METHOD_LEN
+    #define RPC_METHOD_LEN 8
+    #endif
+
+    // status of a call, sent in responses up to Rpc_UnknownMethod
+    typedef enum {
+        Rpc_Ok = 0x00,
+        Rpc_Error = 0x01,  // method failed, set by the handler
+        Rpc_UnknownMethod = 0x02,  // no handler for the method at the receiver
+        Rpc_Timeout = 0x03,  // no response before the deadline
+        Rpc_Dropped = 0x04,  // request not queued, or given up before an answer
+    } Rpc_e;
+
+    // payload header of Command_Request and Command_Response
+    typedef struct __attribute__((packed)) {
+        uint16_t request_id;
+        uint8_t method;
+        uint8_t status;  // Rpc_e, 0 in requests
+    } rpc_header_t;
+
+    #define RPC_HEADER_LEN (sizeof(rpc_header_t))
+    #define MAX_RPC_DATA_LEN (MAX_PAYLOAD_LENGTH - RPC_HEADER_LEN)
+
+    // received request, pass it to respond()
+    struct rpc_request_t {
+        mac_address_t address;
+        uint16_t request_id;
+        uint8_t method;
+        uint16_t packet_id;  // frame of the request, its response acks it
+        uint8_t space;  // Space_e the request was numbered in
+    };
+
+    // request and response data are borrowed, only valid during the callback
+    typedef std::function<void(const rpc_request_t &, std::string_view)> rpc_handler_t;
+    typedef std::function<void(uint8_t, std::string_view)> rpc_callback_t;
+
+    // statistics of one method, calls made by this node and requests served
+    struct rpc_stats_t {
+        uint32_t calls = 0;
+        uint32_t responses = 0;
+        uint32_t errors = 0;  // answered with a status other than Rpc_Ok
+        uint32_t timeouts = 0;
+        uint32_t served = 0;
+        uint32_t latency[HISTOGRAM_LEN] = {};  // request queued to response, ms
+    };
+
+}  // namespace espnow_proxy_base
+}  // esphome
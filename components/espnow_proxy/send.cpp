@@ -5,8 +5,6 @@ namespace espnow_proxy_base {
 
     static const char *TAG = "espnow_proxy_base.send";
 
-    packet_data_t buffer;
-
     Command_e get_command(const uint8_t *data, const size_t size) {
 
         if (size <= MAGIC_HEADER_LEN || memcmp(data, MAGIC_HEADER, MAGIC_HEADER_LEN) != 0) {
@@ -15,39 +13,112 @@ namespace espnow_proxy_base {
 
         uint8_t command = data[MAGIC_HEADER_LEN];
 
-        return (Command_e)command;
+        return (Command_e)(command & COMMAND_MASK);
 
     }
 
-    void fill_command_header(uint8_t command, uint8_t packet_id = 0) {
+    uint8_t get_command_flags(const uint8_t *data, const size_t size) {
+
+        if (size <= MAGIC_HEADER_LEN || memcmp(data, MAGIC_HEADER, MAGIC_HEADER_LEN) != 0) {
+            return 0;
+        }
+
+        return data[MAGIC_HEADER_LEN] & COMMAND_FLAG_MASK;
+
+    }
+
+    uint8_t get_command_priority(const uint8_t *data, const size_t size) {
+
+        if (size <= MAGIC_HEADER_LEN || memcmp(data, MAGIC_HEADER, MAGIC_HEADER_LEN) != 0) {
+            return 0;
+        }
 
-        memcpy(buffer.command_header.magic, MAGIC_HEADER, MAGIC_HEADER_LEN);
-        buffer.command_header.command = command;
-        buffer.command_header.packet_id = packet_id;
+        return (data[MAGIC_HEADER_LEN] & COMMAND_PRIORITY_MASK) >> COMMAND_PRIORITY_SHIFT;
 
     }
 
-    bool send_command_data(uint8_t *dest, uint8_t *data, uint8_t size, uint8_t packet_id) {
+    void fill_command_header(packet_data_t *frame, uint8_t command, uint16_t packet_id = 0) {
+
+        memcpy(frame->command_header.magic, MAGIC_HEADER, MAGIC_HEADER_LEN);
+        frame->command_header.command = command;
+        frame->command_header.packet_id = packet_id;
+
+    }
+
+    // every frame is built in its own transmit frame, owned until completion
+    tx_frame_t *alloc_command_frame(uint8_t command, uint16_t packet_id) {
+
+        tx_frame_t *frame = alloc_frame();
+        if (!frame) {
+            PACKET_LOGD(TAG, "No free transmit frame");
+            return nullptr;
+        }
+        fill_command_header(&frame->data, command, packet_id);
+        return frame;
+
+    }
+
+    bool send_command(uint8_t *dest, uint8_t command, uint8_t *data, uint8_t size, uint16_t packet_id) {
 
         if (size > MAX_PAYLOAD_LENGTH) {
             return false;
         }
 
-        fill_command_header(Command_Data, packet_id);
-        memcpy(buffer.command_data.data, data, size);
+        tx_frame_t *frame = alloc_command_frame(command, packet_id);
+        if (!frame) {
+            return false;
+        }
+        memcpy(frame->data.command_data.data, data, size);
+
+        return send_frame(dest, frame, size + HEADER_LEN);
+
+    }
+
+    bool send_command_data(uint8_t *dest, uint8_t *data, uint8_t size, uint16_t packet_id) {
 
-        return send(dest, buffer.raw, size + HEADER_LEN);
+        return send_command(dest, Command_Data, data, size, packet_id);
 
     }
 
-    bool send_command_data_ack(uint8_t *dest, uint8_t packet_id_acked, uint8_t packet_id) {
+    bool send_command_data_ack(uint8_t *dest, uint16_t packet_id_acked, uint16_t packet_id) {
+
+        tx_frame_t *frame = alloc_command_frame(Command_DataAck, packet_id);
+        if (!frame) {
+            return false;
+        }
+        frame->data.command_data_ack.packet_id_acked = packet_id_acked;
+
+        return send_frame(dest, frame, sizeof(command_data_ack_t));
+
+    }
 
-        fill_command_header(Command_DataAck, packet_id);
-        buffer.command_data_ack.packet_id_acked = packet_id_acked;
+    bool send_command_data_sack(
+        uint8_t *dest, uint16_t packet_id_acked, uint32_t sack_bitmap, uint8_t credit, uint16_t packet_id, uint8_t flags) {
+
+        tx_frame_t *frame = alloc_command_frame(Command_DataSack | flags, packet_id);
+        if (!frame) {
+            return false;
+        }
+        frame->data.command_data_sack.packet_id_acked = packet_id_acked;
+        frame->data.command_data_sack.sack_bitmap = sack_bitmap;
+        frame->data.command_data_sack.credit = credit;
+
+        return send_frame(dest, frame, sizeof(command_data_sack_t));
+
+    }
+
+    bool send_command_data_nack(uint8_t *dest, uint16_t packet_id_highest, uint32_t nack_bitmap, uint16_t packet_id) {
+
+        tx_frame_t *frame = alloc_command_frame(Command_DataNack, packet_id);
+        if (!frame) {
+            return false;
+        }
+        frame->data.command_data_nack.packet_id_highest = packet_id_highest;
+        frame->data.command_data_nack.nack_bitmap = nack_bitmap;
 
-        return send(dest, buffer.raw, sizeof(command_data_ack_t));
+        return send_frame(dest, frame, sizeof(command_data_nack_t));
 
     }
 
 }  // namespace espnow_proxy_base
-}  // esphome
\ No newline at end of file
+}  // esphome
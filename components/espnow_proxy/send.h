@@ -5,12 +5,20 @@
 namespace esphome {
 namespace espnow_proxy_base {
 
-    static const uint8_t MAGIC_HEADER[MAGIC_HEADER_LEN] = {0xD3, 0xFC};
+    // second byte is the protocol version, 0xFC used 8 bit packet ids
+    static const uint8_t MAGIC_HEADER[MAGIC_HEADER_LEN] = {0xD3, 0xFD};
 
     Command_e get_command(const uint8_t *data, const size_t size);
+    uint8_t get_command_flags(const uint8_t *data, const size_t size);
+    uint8_t get_command_priority(const uint8_t *data, const size_t size);
 
-    bool send_command_data(uint8_t *dest, uint8_t *data, uint8_t size, uint8_t packet_id=0);
-    bool send_command_data_ack(uint8_t *dest, uint8_t packet_id_acked=0, uint8_t packet_id=0);
+    bool send_command(uint8_t *dest, uint8_t command, uint8_t *data, uint8_t size, uint16_t packet_id=0);
+    bool send_command_data(uint8_t *dest, uint8_t *data, uint8_t size, uint16_t packet_id=0);
+    bool send_command_data_ack(uint8_t *dest, uint16_t packet_id_acked=0, uint16_t packet_id=0);
+    bool send_command_data_sack(
+        uint8_t *dest, uint16_t packet_id_acked, uint32_t sack_bitmap, uint8_t credit=CREDIT_UNKNOWN, uint16_t packet_id=0,
+        uint8_t flags=0);
+    bool send_command_data_nack(uint8_t *dest, uint16_t packet_id_highest, uint32_t nack_bitmap, uint16_t packet_id=0);
 
 }  // namespace espnow_proxy_base
 }  // esphome
\ No newline at end of file
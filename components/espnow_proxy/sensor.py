@@ -0,0 +1,126 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_ID,
+    CONF_MAC_ADDRESS,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+)
+
+from . import ESPNowProxy, proxy_ns
+
+DEPENDENCIES = ["espnow_proxy"]
+
+CONF_ESPNOW_PROXY_ID = "espnow_proxy_id"
+
+CONF_DELIVERED = "delivered"
+CONF_RETRANSMITS = "retransmits"
+CONF_TIMEOUTS = "timeouts"
+CONF_DROPPED = "dropped"
+CONF_REPLACED = "replaced"
+CONF_RECEIVED = "received"
+CONF_DUPLICATES = "duplicates"
+CONF_OUT_OF_ORDER = "out_of_order"
+CONF_QUEUE_HIGH_WATER = "queue_high_water"
+CONF_RTT = "rtt"
+CONF_RTT_P90 = "rtt_p90"
+CONF_LATENCY_P50 = "latency_p50"
+CONF_LATENCY_P90 = "latency_p90"
+CONF_RPC_METHOD = "rpc_method"
+CONF_RPC_CALLS = "rpc_calls"
+CONF_RPC_ERRORS = "rpc_errors"
+CONF_RPC_TIMEOUTS = "rpc_timeouts"
+CONF_RPC_LATENCY_P50 = "rpc_latency_p50"
+CONF_RPC_LATENCY_P90 = "rpc_latency_p90"
+
+ESPNowProxySensor = proxy_ns.class_(
+    "ESPNowProxySensor", cg.PollingComponent, cg.Parented.template(ESPNowProxy)
+)
+
+COUNTERS = [
+    CONF_DELIVERED,
+    CONF_RETRANSMITS,
+    CONF_TIMEOUTS,
+    CONF_DROPPED,
+    CONF_REPLACED,
+    CONF_RECEIVED,
+    CONF_DUPLICATES,
+    CONF_OUT_OF_ORDER,
+]
+
+TIMES = [
+    CONF_RTT,
+    CONF_RTT_P90,
+    CONF_LATENCY_P50,
+    CONF_LATENCY_P90,
+]
+
+# calls of rpc_method made by this node
+RPC_COUNTERS = [
+    CONF_RPC_CALLS,
+    CONF_RPC_ERRORS,
+    CONF_RPC_TIMEOUTS,
+]
+
+RPC_TIMES = [
+    CONF_RPC_LATENCY_P50,
+    CONF_RPC_LATENCY_P90,
+]
+
+counter_schema = sensor.sensor_schema(
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+time_schema = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+CONFIG_SCHEMA = cv.Schema({
+    cv.GenerateID(): cv.declare_id(ESPNowProxySensor),
+    cv.GenerateID(CONF_ESPNOW_PROXY_ID): cv.use_id(ESPNowProxy),
+    cv.Optional(CONF_MAC_ADDRESS): cv.mac_address,
+    **{cv.Optional(key): counter_schema for key in COUNTERS},
+    cv.Optional(CONF_QUEUE_HIGH_WATER): sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    **{cv.Optional(key): time_schema for key in TIMES},
+    cv.Optional(CONF_RPC_METHOD): cv.uint8_t,
+    **{cv.Optional(key): counter_schema for key in RPC_COUNTERS},
+    **{cv.Optional(key): time_schema for key in RPC_TIMES},
+}).extend(cv.polling_component_schema("60s"))
+
+
+def validate_rpc_method(config):
+    if CONF_RPC_METHOD not in config and any(key in config for key in RPC_COUNTERS + RPC_TIMES):
+        raise cv.Invalid(f"{CONF_RPC_METHOD} is required for rpc sensors")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(CONFIG_SCHEMA, validate_rpc_method)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    await cg.register_parented(var, config[CONF_ESPNOW_PROXY_ID])
+
+    if CONF_MAC_ADDRESS in config:
+        cg.add(var.set_address(config[CONF_MAC_ADDRESS].as_hex))
+
+    if CONF_RPC_METHOD in config:
+        cg.add(var.set_rpc_method(config[CONF_RPC_METHOD]))
+
+    for key in COUNTERS + [CONF_QUEUE_HIGH_WATER] + TIMES + RPC_COUNTERS + RPC_TIMES:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, f"set_{key}_sensor")(sens))
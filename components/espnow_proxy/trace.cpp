@@ -0,0 +1,41 @@
+#include "trace.h"
+#include "radio.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    static trace_event_t trace_events_[TRACE_LEN];
+    static uint32_t trace_count_ = 0;
+
+    void trace_add(uint8_t event, uint8_t command, uint16_t packet_id, mac_address_t address) {
+        trace_event_t *item = &trace_events_[trace_count_++ % TRACE_LEN];
+        item->time = clock_micros();
+        item->event = event;
+        item->command = command;
+        item->packet_id = packet_id;
+        item->address = address & 0xFFFF;
+    }
+
+    size_t trace_read(trace_event_t *events, size_t max, size_t offset) {
+        size_t total = trace_count_ < TRACE_LEN ? trace_count_ : TRACE_LEN;
+        if (offset >= total) {
+            return 0;
+        }
+        size_t count = total - offset < max ? total - offset : max;
+        uint32_t first = trace_count_ - total + offset;
+        for (size_t i = 0; i < count; i++) {
+            events[i] = trace_events_[(first + i) % TRACE_LEN];
+        }
+        return count;
+    }
+
+    uint32_t trace_count() {
+        return trace_count_;
+    }
+
+    void trace_clear() {
+        trace_count_ = 0;
+    }
+
+}  // namespace espnow_proxy_base
+}  // esphome
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common.h"
+
+namespace esphome {
+namespace espnow_proxy_base {
+
+    // Binary trace of the packet path, compact event ids instead of text.
+    // Only compiled in with trace_size set in yaml, TRACE() is a no-op
+    // otherwise. The oldest events are overwritten when the buffer is full.
+
+    #ifndef TRACE_LEN
+    #define TRACE_LEN 256
+    #endif
+
+    typedef enum {
+        Trace_Recv = 0x00,  // frame taken from the receive queue
+        Trace_Deliver = 0x01,  // data handed to the application
+        Trace_Duplicate = 0x02,
+        Trace_Queue = 0x03,  // message added to a send queue
+        Trace_Drop = 0x04,  // send queue full
+        Trace_Send = 0x05,  // first transmission
+        Trace_Retransmit = 0x06,
+        Trace_Timeout = 0x07,  // message given up
+        Trace_Acked = 0x08,
+        Trace_Nack = 0x09,
+        Trace_SendFail = 0x0A,  // frame not taken by the radio
+        Trace_Replace = 0x0B,  // keyed message superseded by a newer value
+    } Trace_e;
+
+    typedef struct __attribute__((packed)) {
+        uint32_t time;  // us
+        uint8_t event;
+        uint8_t command;
+        uint16_t packet_id;
+        uint16_t address;  // last two bytes of the peer address
+    } trace_event_t;
+
+    void trace_add(uint8_t event, uint8_t command, uint16_t packet_id, mac_address_t address);
+    // copies up to max events, oldest first skipping offset events, returns
+    // the number copied
+    size_t trace_read(trace_event_t *events, size_t max, size_t offset=0);
+    // events recorded since start, including overwritten ones
+    uint32_t trace_count();
+    void trace_clear();
+
+    #ifdef USE_ESPNOW_PROXY_TRACE
+    #define TRACE(event, command, packet_id, address) \
+        espnow_proxy_base::trace_add(event, command, packet_id, address)
+    #else
+    #define TRACE(event, command, packet_id, address) do {} while (0)
+    #endif
+
+}  // namespace espnow_proxy_base
+}  // esphome
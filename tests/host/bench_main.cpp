@@ -0,0 +1,17 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+// Prints the results of the benchmark groups given, all of them without
+// arguments, as json lines:
+//
+//   espnow_proxy_bench [micro] [peer_table] [queues] [peer_cache] [link] [window] [broadcast] [overload] [coalesce]
+int main(int argc, char **argv) {
+
+    std::vector<std::string> groups(argv + 1, argv + argc);
+    printf("%s", esphome::espnow_proxy::run_benchmarks(groups).c_str());
+    return 0;
+
+}
@@ -0,0 +1,716 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "benchmark.h"
+
+namespace esphome {
+namespace espnow_proxy {
+
+    // node addresses on the simulated medium
+    static const mac_address_t BENCH_SENDER = 0x02000000BE01ULL;
+    static const mac_address_t BENCH_RECEIVER = 0x02000000BE02ULL;
+    static const mac_address_t BENCH_SILENT = 0x02000000BE03ULL;  // nobody answers
+    static const mac_address_t BENCH_MISSING = 0x02000000BEFFULL;  // not on the medium
+    static const uint8_t BENCH_NODE_SENDER = 0;
+    static const uint8_t BENCH_NODE_RECEIVER = 1;
+    static const uint8_t BENCH_NODE_SILENT = 2;
+    static const mac_address_t BENCH_BROADCASTER = 0x02000000BE10ULL;  // receivers follow
+    static const uint8_t BENCH_NODE_BROADCASTER = 3;
+    static const uint32_t BENCH_TICK_US = 1000;
+
+    // exposes the queue pre processing to the benchmark
+    class BenchProxy : public ESPNowProxy {
+        public:
+            using ESPNowProxy::pre_process_queues_;
+    };
+
+    struct bench_nodes_t {
+        BenchProxy *sender;
+        BenchProxy *receiver;
+        BenchProxy *silent;
+        // deliveries to the receiver, in us of virtual time
+        std::vector<uint32_t> latencies;
+        // send time of the newest value delivered and when it arrived
+        uint64_t newest;
+        uint64_t newest_time;
+    };
+
+    // proxies live for the whole process, callbacks registered in the base
+    // can not be removed
+    static bench_nodes_t &bench_nodes_() {
+
+        static bench_nodes_t nodes{};
+        if (nodes.sender) {
+            return nodes;
+        }
+        auto &sim = SimMedium::get();
+        sim.add_node(BENCH_SENDER);
+        sim.add_node(BENCH_RECEIVER);
+        sim.add_node(BENCH_SILENT);
+
+        sim.select(BENCH_NODE_SENDER);
+        nodes.sender = new BenchProxy();
+        nodes.sender->set_address(BENCH_RECEIVER);
+        nodes.sender->set_peer(BENCH_RECEIVER);
+        nodes.sender->setup();
+
+        sim.select(BENCH_NODE_RECEIVER);
+        nodes.receiver = new BenchProxy();
+        nodes.receiver->set_address(BENCH_SENDER);
+        nodes.receiver->set_peer(BENCH_SENDER);
+        nodes.receiver->setup();
+
+        // the payload carries the virtual send time, latency is measured
+        // from the send call to the delivery to the application
+        nodes.receiver->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+            uint64_t sent;
+            if (address != BENCH_SENDER || x.size() < sizeof(sent)) {
+                return;
+            }
+            memcpy(&sent, x.data(), sizeof(sent));
+            nodes.latencies.push_back(SimMedium::get().now() - sent);
+            if (sent >= nodes.newest) {
+                nodes.newest = sent;
+                nodes.newest_time = SimMedium::get().now();
+            }
+        });
+
+        sim.select(BENCH_NODE_SILENT);
+        nodes.silent = new BenchProxy();
+        nodes.silent->set_address(BENCH_MISSING);
+        for (auto idx = 0; idx < MAX_PEERS; idx++) {
+            nodes.silent->set_peer(BENCH_MISSING - idx);
+        }
+        nodes.silent->setup();
+
+        return nodes;
+
+    }
+
+    struct bench_broadcast_t {
+        BenchProxy *sender;
+        std::vector<BenchProxy *> receivers;
+        uint32_t delivered;
+    };
+
+    // a broadcaster and as many receivers as the medium has nodes left
+    static bench_broadcast_t &bench_broadcast_nodes_() {
+
+        static bench_broadcast_t nodes{};
+        if (nodes.sender) {
+            return nodes;
+        }
+        bench_nodes_();
+        auto &sim = SimMedium::get();
+        sim.add_node(BENCH_BROADCASTER);
+        uint8_t count = RADIO_NODE_LEN - BENCH_NODE_BROADCASTER - 1;
+        for (uint8_t idx = 1; idx <= count; idx++) {
+            sim.add_node(BENCH_BROADCASTER + idx);
+        }
+
+        // no receiver configured, sends go to everyone. sent messages are
+        // kept for nacks and take queue slots
+        sim.select(BENCH_NODE_BROADCASTER);
+        nodes.sender = new BenchProxy();
+        nodes.sender->set_max_queue_length(SEND_POOL_LEN);
+        for (uint8_t idx = 1; idx <= count; idx++) {
+            nodes.sender->set_peer(BENCH_BROADCASTER + idx);
+        }
+        nodes.sender->setup();
+
+        for (uint8_t idx = 1; idx <= count; idx++) {
+            sim.select(BENCH_NODE_BROADCASTER + idx);
+            BenchProxy *receiver = new BenchProxy();
+            receiver->set_address(BENCH_BROADCASTER);
+            receiver->set_peer(BENCH_BROADCASTER);
+            receiver->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+                nodes.delivered += address == BENCH_BROADCASTER;
+            });
+            receiver->setup();
+            nodes.receivers.push_back(receiver);
+        }
+
+        return nodes;
+
+    }
+
+    template<typename F> static double time_ns_(uint32_t iterations, F &&fn) {
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            fn(i);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / (iterations ? iterations : 1);
+
+    }
+
+    // keeps the compiler from dropping results
+    static volatile uint64_t bench_sink_;
+
+    void bench_micro(std::vector<bench_result_t> &results, uint32_t iterations) {
+
+        auto &nodes = bench_nodes_();
+        auto &sim = SimMedium::get();
+        uint8_t address[MAC_ADDRESS_LEN] = {0x02, 0x00, 0x00, 0x00, 0xBE, 0x01};
+
+        results.push_back({"micro.addr_to_addr64", "time", time_ns_(iterations, [&](uint32_t i) {
+            address[5] = i;
+            bench_sink_ = addr_to_addr64(address);
+        }), "ns/op"});
+
+        results.push_back({"micro.addr64_to_str", "time", time_ns_(iterations, [&](uint32_t i) {
+            bench_sink_ = addr64_to_str(BENCH_SENDER + i).size();
+        }), "ns/op"});
+
+        // the stack buffer formatting used by the packet path logs, and the
+        // binary trace replacing them
+        results.push_back({"micro.mac_str", "time", time_ns_(iterations, [&](uint32_t i) {
+            bench_sink_ = mac_str(BENCH_SENDER + i).c_str()[16];
+        }), "ns/op"});
+
+        results.push_back({"micro.trace_add", "time", time_ns_(iterations, [&](uint32_t i) {
+            trace_add(Trace_Recv, Command_Data, i, BENCH_SENDER);
+        }), "ns/op"});
+        trace_clear();
+
+        packet_data_t packet{};
+        memcpy(packet.command_header.magic, MAGIC_HEADER, MAGIC_HEADER_LEN);
+        results.push_back({"micro.get_command", "time", time_ns_(iterations, [&](uint32_t i) {
+            packet.command_header.command = 1 + i % Command_DataNack;
+            bench_sink_ = get_command(packet.raw, sizeof(command_data_sack_t));
+        }), "ns/op"});
+
+        // header, payload copy and the hand over to the (simulated) radio,
+        // the frame is addressed to a node that is not on the medium
+        sim_config_t config{};
+        config.bitrate = 0;
+        config.latency = 0;
+        sim.configure(config);
+        sim.select(BENCH_NODE_SILENT);
+        uint8_t data[MAX_PAYLOAD_LENGTH] = {};
+        uint8_t dest[MAC_ADDRESS_LEN];
+        memcpy(dest, addr64_to_addr(BENCH_MISSING), MAC_ADDRESS_LEN);
+        results.push_back({"micro.send_command_data", "time", time_ns_(iterations, [&](uint32_t i) {
+            bench_sink_ = send_command_data(dest, data, sizeof(data), i);
+            sim.advance(0);
+        }), "ns/op"});
+
+        results.push_back({"micro.peer_lookup", "time", time_ns_(iterations, [&](uint32_t i) {
+            bench_sink_ = (uintptr_t)nodes.silent->get_link(BENCH_MISSING - i % MAX_PEERS);
+        }), "ns/op"});
+
+        results.push_back({"micro.peer_lookup_miss", "time", time_ns_(iterations, [&](uint32_t i) {
+            bench_sink_ = (uintptr_t)nodes.silent->get_link(BENCH_SENDER + i);
+        }), "ns/op"});
+
+    }
+
+    // the lookup before the peer table: station address, then the softAP
+    // alias through the shared address buffer, logging the address
+    static void *map_lookup_(std::map<mac_address_t, void *> &peers, mac_address_t address, bool logged) {
+
+        if (logged) {
+            bench_sink_ = addr64_to_str(address).size();
+        }
+        if (peers.find(address) != peers.end()) {
+            return peers[address];
+        }
+        uint8_t *base_address = addr64_to_addr(address);
+        base_address[MAC_ADDRESS_LEN - 1]--;
+        mac_address_t temp_address = addr_to_addr64(base_address);
+        if (peers.find(temp_address) != peers.end()) {
+            return peers[temp_address];
+        }
+        return nullptr;
+
+    }
+
+    void bench_peer_table(std::vector<bench_result_t> &results, uint8_t peers, uint32_t iterations) {
+
+        // spread over the address space like real vendor prefixes
+        std::vector<mac_address_t> addresses;
+        for (uint8_t idx = 0; idx < peers; idx++) {
+            addresses.push_back(0x24000000AA00ULL + idx * 0x010203040506ULL % 0xFFFFFFFF00ULL);
+        }
+        static int values[MAX_PEERS * 4];
+        PeerTable<int, PEER_TABLE_LEN> table;
+        std::map<mac_address_t, void *> map;
+        for (uint8_t idx = 0; idx < peers; idx++) {
+            table.insert(addresses[idx], &values[idx % (MAX_PEERS * 4)]);
+            map[addresses[idx]] = &values[idx % (MAX_PEERS * 4)];
+        }
+
+        struct lookup_case_t {
+            const char *name;
+            std::function<mac_address_t(uint32_t)> address;
+        };
+        lookup_case_t cases[] = {
+            {"station", [&](uint32_t i) { return addresses[i % peers]; }},
+            {"softap", [&](uint32_t i) { return softap_alias(addresses[i % peers]); }},
+            {"miss", [&](uint32_t i) { return BENCH_MISSING + 0x100 + i % 251; }},
+        };
+        for (auto &item : cases) {
+            // addresses are precomputed, only the lookup is timed
+            std::vector<mac_address_t> keys;
+            for (uint32_t i = 0; i < iterations; i++) {
+                keys.push_back(item.address(i));
+            }
+            char name[48];
+            snprintf(name, sizeof(name), "peer_table.table_%s", item.name);
+            results.push_back({name, "time", time_ns_(iterations, [&](uint32_t i) {
+                auto entry = table.find(keys[i]);
+                bench_sink_ = (uintptr_t)(entry ? entry->value : nullptr);
+            }), "ns/op"});
+            snprintf(name, sizeof(name), "peer_table.map_%s", item.name);
+            results.push_back({name, "time", time_ns_(iterations, [&](uint32_t i) {
+                bench_sink_ = (uintptr_t)map_lookup_(map, keys[i], false);
+            }), "ns/op"});
+            snprintf(name, sizeof(name), "peer_table.map_logged_%s", item.name);
+            results.push_back({name, "time", time_ns_(iterations, [&](uint32_t i) {
+                bench_sink_ = (uintptr_t)map_lookup_(map, keys[i], true);
+            }), "ns/op"});
+        }
+        results.push_back({"peer_table.table_probes", "probes", (double)table.get_probes(), "slots"});
+
+    }
+
+    // queue messages to every peer of the silent node until no more fit
+    static void fill_queues_(BenchProxy *proxy) {
+
+        uint8_t data[32] = {};
+        for (auto idx = 0; idx < MAX_PEERS; idx++) {
+            send_options_t options{BENCH_MISSING - idx, Priority_Telemetry};
+            while (proxy->send(data, sizeof(data), options)) {
+            }
+        }
+
+    }
+
+    void bench_queues(std::vector<bench_result_t> &results, uint32_t iterations) {
+
+        auto &nodes = bench_nodes_();
+        auto &sim = SimMedium::get();
+        sim.configure(sim_config_t{});
+        sim.select(BENCH_NODE_SILENT);
+
+        // wall clock is only taken around the measured call, refilling and
+        // the virtual clock run outside of it
+        double total = 0;
+        for (uint32_t i = 0; i < iterations; i++) {
+            fill_queues_(nodes.silent);
+            total += time_ns_(1, [&](uint32_t) { nodes.silent->pre_process_queues_(); });
+            sim.advance(BENCH_TICK_US);
+            sim.select(BENCH_NODE_SILENT);
+        }
+        results.push_back({"queue.pre_process_queues", "time", total / iterations, "ns/op"});
+        results.push_back({"queue.depth", "messages", (double)nodes.silent->get_send_queue_depth(), "messages"});
+
+        total = 0;
+        for (uint32_t i = 0; i < iterations; i++) {
+            fill_queues_(nodes.silent);
+            total += time_ns_(1, [&](uint32_t) { nodes.silent->loop(); });
+            sim.advance(BENCH_TICK_US);
+            sim.select(BENCH_NODE_SILENT);
+        }
+        results.push_back({"queue.loop", "time", total / iterations, "ns/op"});
+
+    }
+
+    static void bench_peer_access_(
+        std::vector<bench_result_t> &results, const char *name, uint8_t peers, uint8_t hot_percent, uint32_t iterations) {
+
+        auto &sim = SimMedium::get();
+        sim.select(BENCH_NODE_SILENT);
+        const peer_registry_t *registry = get_peer_registry();
+        uint32_t hits = registry->hits;
+        uint32_t misses = registry->misses;
+        uint32_t evictions = registry->evictions;
+
+        uint8_t data[16] = {};
+        uint8_t hot = std::max(1, peers / 5);
+        double ns = time_ns_(iterations, [&](uint32_t) {
+            uint32_t pick = sim.random();
+            uint8_t idx = pick % 100 < hot_percent ? (pick >> 8) % hot : (pick >> 8) % peers;
+            uint8_t dest[MAC_ADDRESS_LEN];
+            memcpy(dest, addr64_to_addr(BENCH_MISSING - 0x100 - idx), MAC_ADDRESS_LEN);
+            espnow_proxy_base::send(dest, data, sizeof(data));
+            sim.advance(0);
+        });
+
+        hits = registry->hits - hits;
+        misses = registry->misses - misses;
+        results.push_back({name, "time", ns, "ns/op"});
+        results.push_back({name, "hit_rate", 100.0 * hits / (hits + misses ? hits + misses : 1), "%"});
+        results.push_back({name, "evictions", (double)(registry->evictions - evictions), "peers"});
+
+    }
+
+    void bench_peer_cache(std::vector<bench_result_t> &results, uint8_t peers, uint8_t hot_percent, uint32_t iterations) {
+
+        bench_nodes_();
+        sim_config_t config{};
+        config.bitrate = 0;
+        config.latency = 0;
+        SimMedium::get().configure(config);
+
+        // every access pattern starts with a warm table
+        bench_peer_access_(results, "peer_cache.uniform", peers, 0, iterations);
+        bench_peer_access_(results, "peer_cache.skewed", peers, hot_percent, iterations);
+
+    }
+
+    static double percentile_(std::vector<uint32_t> &values, uint8_t percent) {
+
+        if (values.empty()) {
+            return 0;
+        }
+        size_t index = (values.size() - 1) * percent / 100;
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+
+    }
+
+    void bench_link(std::vector<bench_result_t> &results, const std::vector<uint8_t> &loss_percent, uint32_t duration_ms) {
+
+        auto &nodes = bench_nodes_();
+        auto &sim = SimMedium::get();
+
+        for (auto loss : loss_percent) {
+            sim_config_t config{};
+            config.loss_percent = loss;
+            config.jitter = 200;
+            sim.configure(config);
+            nodes.latencies.clear();
+            uint32_t accepted = 0;
+
+            uint64_t start = sim.now();
+            for (uint32_t tick = 0; tick < duration_ms * 1000 / BENCH_TICK_US; tick++) {
+                sim.select(BENCH_NODE_SENDER);
+                // offer as much as the sender accepts
+                uint8_t data[16] = {};
+                uint64_t now = sim.now();
+                memcpy(data, &now, sizeof(now));
+                while (nodes.sender->send(data, sizeof(data))) {
+                    accepted++;
+                }
+                nodes.sender->loop();
+                sim.select(BENCH_NODE_RECEIVER);
+                nodes.receiver->loop();
+                sim.advance(BENCH_TICK_US);
+            }
+            double seconds = (sim.now() - start) / 1e6;
+
+            char name[32];
+            snprintf(name, sizeof(name), "link.loss_%d", loss);
+            results.push_back({name, "throughput", nodes.latencies.size() / seconds, "messages/s"});
+            results.push_back({name, "latency_p50", percentile_(nodes.latencies, 50) / 1000.0, "ms"});
+            results.push_back({name, "latency_p99", percentile_(nodes.latencies, 99) / 1000.0, "ms"});
+            results.push_back({name, "accepted", (double)accepted, "messages"});
+            results.push_back({name, "medium_utilization", (double)sim.get_utilization(), "%"});
+
+            // let outstanding messages finish before the next loss rate
+            sim.configure(sim_config_t{});
+            for (uint32_t tick = 0; tick < SEND_TIMEOUT_MS * 1000 / BENCH_TICK_US; tick++) {
+                sim.select(BENCH_NODE_SENDER);
+                nodes.sender->loop();
+                sim.select(BENCH_NODE_RECEIVER);
+                nodes.receiver->loop();
+                sim.advance(BENCH_TICK_US);
+            }
+        }
+
+    }
+
+    void bench_window(
+        std::vector<bench_result_t> &results, const std::vector<uint8_t> &window_sizes,
+        const std::vector<uint8_t> &loss_percent, uint32_t latency_us, uint32_t duration_ms) {
+
+        auto &nodes = bench_nodes_();
+        auto &sim = SimMedium::get();
+
+        // the queue holds a window more than in flight, so the window is the
+        // limit and not the queue
+        for (auto loss : loss_percent) {
+            for (auto window : window_sizes) {
+                sim_config_t config{};
+                config.loss_percent = loss;
+                config.latency = latency_us;
+                config.jitter = latency_us / 10;
+                sim.configure(config);
+                nodes.sender->set_window_size(window);
+                nodes.sender->set_max_queue_length(std::min(2 * window, SEND_POOL_LEN));
+                nodes.latencies.clear();
+                link_stats_t *stats = nodes.sender->get_link(BENCH_RECEIVER)->get_stats();
+                uint32_t retransmits = stats->retransmits;
+
+                uint64_t start = sim.now();
+                for (uint32_t tick = 0; tick < duration_ms * 1000 / BENCH_TICK_US; tick++) {
+                    sim.select(BENCH_NODE_SENDER);
+                    uint8_t data[16] = {};
+                    uint64_t now = sim.now();
+                    memcpy(data, &now, sizeof(now));
+                    while (nodes.sender->send(data, sizeof(data))) {
+                    }
+                    nodes.sender->loop();
+                    sim.select(BENCH_NODE_RECEIVER);
+                    nodes.receiver->loop();
+                    sim.advance(BENCH_TICK_US);
+                }
+                double seconds = (sim.now() - start) / 1e6;
+
+                char name[32];
+                snprintf(name, sizeof(name), "window.size_%d_loss_%d", window, loss);
+                results.push_back({name, "throughput", nodes.latencies.size() / seconds, "messages/s"});
+                results.push_back({name, "latency_p50", percentile_(nodes.latencies, 50) / 1000.0, "ms"});
+                results.push_back({name, "retransmits", (double)(stats->retransmits - retransmits), "frames"});
+
+                // let outstanding messages finish before the next run
+                sim.configure(sim_config_t{});
+                for (uint32_t tick = 0; tick < SEND_TIMEOUT_MS * 1000 / BENCH_TICK_US; tick++) {
+                    sim.select(BENCH_NODE_SENDER);
+                    nodes.sender->loop();
+                    sim.select(BENCH_NODE_RECEIVER);
+                    nodes.receiver->loop();
+                    sim.advance(BENCH_TICK_US);
+                }
+            }
+        }
+        nodes.sender->set_window_size(4);
+        nodes.sender->set_max_queue_length(5);
+
+    }
+
+    void bench_broadcast(
+        std::vector<bench_result_t> &results, uint8_t receivers, const std::vector<uint8_t> &loss_percent,
+        uint32_t interval_ms, uint32_t duration_ms) {
+
+        auto &nodes = bench_broadcast_nodes_();
+        auto &sim = SimMedium::get();
+        receivers = std::min(receivers, (uint8_t)nodes.receivers.size());
+        static const char *MODES[] = {"ack", "unacked", "nack"};
+
+        // the receivers not taking part do not loop and miss everything,
+        // they are not counted
+        auto step = [&]() {
+            sim.select(BENCH_NODE_BROADCASTER);
+            nodes.sender->loop();
+            for (uint8_t idx = 0; idx < receivers; idx++) {
+                sim.select(BENCH_NODE_BROADCASTER + 1 + idx);
+                nodes.receivers[idx]->loop();
+            }
+            sim.advance(BENCH_TICK_US);
+        };
+
+        for (auto loss : loss_percent) {
+            for (uint8_t mode : {BroadcastMode_Ack, BroadcastMode_Unacked, BroadcastMode_Nack}) {
+                sim_config_t config{};
+                config.loss_percent = loss;
+                config.jitter = 200;
+                sim.configure(config);
+                nodes.sender->set_broadcast_mode(mode);
+                nodes.delivered = 0;
+                uint32_t sent = sim.get_stats().sent;
+                uint64_t airtime = sim.get_stats().airtime;
+                uint32_t messages = 0;
+
+                uint64_t start = sim.now();
+                for (uint32_t tick = 0; tick < duration_ms * 1000 / BENCH_TICK_US; tick++) {
+                    if (tick % interval_ms == 0) {
+                        sim.select(BENCH_NODE_BROADCASTER);
+                        uint8_t data[32] = {};
+                        messages += (bool)nodes.sender->send(data, sizeof(data));
+                    }
+                    step();
+                }
+                // late nacks and retransmissions still count
+                for (uint32_t tick = 0; tick < SEND_TIMEOUT_MS * 1000 / BENCH_TICK_US; tick++) {
+                    step();
+                }
+                double elapsed = sim.now() - start;
+
+                char name[48];
+                snprintf(name, sizeof(name), "broadcast.%s_nodes_%d_loss_%d", MODES[mode], receivers, loss);
+                uint32_t expected = messages * receivers;
+                results.push_back({
+                    name, "medium_utilization", 100.0 * (sim.get_stats().airtime - airtime) / elapsed, "%"});
+                results.push_back({name, "frames_sent", (double)(sim.get_stats().sent - sent), "frames"});
+                results.push_back({name, "accepted", (double)messages, "messages"});
+                results.push_back({
+                    name, "frames_per_message", (double)(sim.get_stats().sent - sent) / (messages ? messages : 1), "frames"});
+                results.push_back({name, "delivered", 100.0 * nodes.delivered / (expected ? expected : 1), "%"});
+            }
+        }
+        nodes.sender->set_broadcast_mode(BroadcastMode_Ack);
+
+    }
+
+    void bench_overload(std::vector<bench_result_t> &results, uint32_t loop_interval_ms, uint32_t duration_ms) {
+
+        auto &nodes = bench_nodes_();
+        auto &sim = SimMedium::get();
+        sim.configure(sim_config_t{});
+
+        // the sender may have more in flight than the receiver queues, which
+        // takes one frame per loop and loops rarely
+        nodes.sender->set_window_size(SEND_POOL_LEN);
+        nodes.sender->set_max_queue_length(SEND_POOL_LEN);
+        nodes.receiver->set_recv_limit(4);
+        nodes.receiver->set_loop_budget_messages(1);
+        for (bool flow_control : {false, true}) {
+            nodes.receiver->set_flow_control(flow_control);
+            nodes.latencies.clear();
+            link_stats_t *stats = nodes.sender->get_link(BENCH_RECEIVER)->get_stats();
+            uint32_t retransmits = stats->retransmits;
+            uint32_t timeouts = stats->timeouts;
+            uint32_t dropped = nodes.receiver->get_recv_dropped();
+            uint32_t sent = sim.get_stats().sent;
+
+            uint64_t start = sim.now();
+            for (uint32_t tick = 0; tick < duration_ms * 1000 / BENCH_TICK_US; tick++) {
+                sim.select(BENCH_NODE_SENDER);
+                uint8_t data[16] = {};
+                uint64_t now = sim.now();
+                memcpy(data, &now, sizeof(now));
+                while (nodes.sender->send(data, sizeof(data))) {
+                }
+                nodes.sender->loop();
+                if (tick % loop_interval_ms == 0) {
+                    sim.select(BENCH_NODE_RECEIVER);
+                    nodes.receiver->loop();
+                }
+                sim.advance(BENCH_TICK_US);
+            }
+            double seconds = (sim.now() - start) / 1e6;
+
+            const char *name = flow_control ? "overload.flow_control" : "overload.no_flow_control";
+            results.push_back({name, "throughput", nodes.latencies.size() / seconds, "messages/s"});
+            results.push_back({name, "latency_p50", percentile_(nodes.latencies, 50) / 1000.0, "ms"});
+            results.push_back({name, "recv_dropped", (double)(nodes.receiver->get_recv_dropped() - dropped), "frames"});
+            results.push_back({name, "retransmits", (double)(stats->retransmits - retransmits), "frames"});
+            results.push_back({name, "timeouts", (double)(stats->timeouts - timeouts), "messages"});
+            results.push_back({name, "frames_sent", (double)(sim.get_stats().sent - sent), "frames"});
+
+            // drain at full speed before the next run
+            for (uint32_t tick = 0; tick < SEND_TIMEOUT_MS * 1000 / BENCH_TICK_US; tick++) {
+                sim.select(BENCH_NODE_SENDER);
+                nodes.sender->loop();
+                sim.select(BENCH_NODE_RECEIVER);
+                nodes.receiver->loop();
+                sim.advance(BENCH_TICK_US);
+            }
+        }
+        nodes.sender->set_window_size(4);
+        nodes.sender->set_max_queue_length(5);
+        nodes.receiver->set_recv_limit(RECV_QUEUE_LEN);
+        nodes.receiver->set_loop_budget_messages(8);
+        nodes.receiver->set_flow_control(true);
+
+    }
+
+    void bench_coalesce(std::vector<bench_result_t> &results, uint8_t loss_percent, uint32_t updates) {
+
+        auto &nodes = bench_nodes_();
+        auto &sim = SimMedium::get();
+
+        // a slider dragged over updates values, one per ms, faster than the
+        // link delivers. keyed, only the latest value is kept
+        for (uint8_t key : {0, 1}) {
+            sim_config_t config{};
+            config.loss_percent = loss_percent;
+            config.jitter = 200;
+            sim.configure(config);
+            nodes.latencies.clear();
+            nodes.newest = 0;
+            nodes.newest_time = 0;
+            link_stats_t *stats = nodes.sender->get_link(BENCH_RECEIVER)->get_stats();
+            uint32_t dropped = stats->dropped;
+            uint32_t replaced = stats->replaced;
+            uint32_t sent = sim.get_stats().sent;
+
+            send_options_t options{};
+            options.key = key;
+            uint64_t last = 0;
+            for (uint32_t tick = 0; tick < SEND_TIMEOUT_MS * 1000 / BENCH_TICK_US; tick++) {
+                sim.select(BENCH_NODE_SENDER);
+                if (tick < updates) {
+                    uint8_t data[16] = {};
+                    last = sim.now();
+                    memcpy(data, &last, sizeof(last));
+                    nodes.sender->send(data, sizeof(data), options);
+                }
+                nodes.sender->loop();
+                sim.select(BENCH_NODE_RECEIVER);
+                nodes.receiver->loop();
+                sim.advance(BENCH_TICK_US);
+            }
+
+            char name[32];
+            snprintf(name, sizeof(name), "coalesce.%s_loss_%d", key ? "keyed" : "unkeyed", loss_percent);
+            bool final = nodes.newest == last;
+            results.push_back({name, "final_delivered", final ? 1.0 : 0.0, "bool"});
+            results.push_back({name, "final_latency", final ? (nodes.newest_time - last) / 1000.0 : 0.0, "ms"});
+            results.push_back({name, "delivered", (double)nodes.latencies.size(), "messages"});
+            results.push_back({name, "dropped", (double)(stats->dropped - dropped), "messages"});
+            results.push_back({name, "replaced", (double)(stats->replaced - replaced), "messages"});
+            results.push_back({name, "frames_sent", (double)(sim.get_stats().sent - sent), "frames"});
+        }
+
+    }
+
+    std::string bench_to_json(const std::vector<bench_result_t> &results) {
+
+        std::string out;
+        char line[160];
+        for (auto &result : results) {
+            snprintf(
+                line, sizeof(line), "{\"name\":\"%s\",\"metric\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n",
+                result.name.c_str(), result.metric.c_str(), result.value, result.unit.c_str());
+            out += line;
+        }
+        return out;
+
+    }
+
+    std::string run_benchmarks(const std::vector<std::string> &groups) {
+
+        auto selected = [&](const char *group) {
+            return groups.empty() || std::find(groups.begin(), groups.end(), group) != groups.end();
+        };
+        std::vector<bench_result_t> results;
+        if (selected("micro")) {
+            bench_micro(results);
+        }
+        if (selected("peer_table")) {
+            bench_peer_table(results);
+        }
+        if (selected("queues")) {
+            bench_queues(results);
+        }
+        if (selected("peer_cache")) {
+            bench_peer_cache(results);
+        }
+        if (selected("link")) {
+            bench_link(results);
+        }
+        if (selected("window")) {
+            bench_window(results);
+        }
+        if (selected("broadcast")) {
+            bench_broadcast(results);
+        }
+        if (selected("overload")) {
+            bench_overload(results);
+        }
+        if (selected("coalesce")) {
+            bench_coalesce(results, 0);
+            bench_coalesce(results, 20);
+        }
+        return bench_to_json(results);
+
+    }
+
+}  // namespace espnow_proxy
+}  // namespace esphome
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "espnow_proxy.h"
+#include "radio_sim.h"
+
+namespace esphome {
+namespace espnow_proxy {
+
+    // Benchmarks of the hot paths and of a simulated link, run by
+    // espnow_proxy_bench. Every result is one json object per line, for
+    // tracking regressions:
+    //
+    //   {"name":"micro.addr_to_addr64","metric":"time","value":3.1,"unit":"ns/op"}
+    //
+    // Micro and queue results are wall clock, link results virtual time of
+    // the simulated medium.
+
+    struct bench_result_t {
+        std::string name;
+        std::string metric;
+        double value;
+        std::string unit;
+    };
+
+    // addr conversion and formatting, tracing, command parsing, framing and
+    // peer lookup
+    void bench_micro(std::vector<bench_result_t> &results, uint32_t iterations=100000);
+    // peer resolution of received frames, the flat peer table against the
+    // std::map lookups with softAP fallback it replaced, for station and
+    // softAP addresses and unknown senders
+    void bench_peer_table(std::vector<bench_result_t> &results, uint8_t peers=MAX_PEERS, uint32_t iterations=100000);
+    // loop() and pre_process_queues_() with every send queue full
+    void bench_queues(std::vector<bench_result_t> &results, uint32_t iterations=10000);
+    // sends to more peers than the radio peer table holds, uniform and with
+    // hot_percent of the sends going to 20% of the peers
+    void bench_peer_cache(
+        std::vector<bench_result_t> &results, uint8_t peers=60, uint8_t hot_percent=80, uint32_t iterations=100000);
+    // messages/s and p50/p99 delivery latency between two nodes per loss rate
+    void bench_link(
+        std::vector<bench_result_t> &results, const std::vector<uint8_t> &loss_percent={0, 5, 10, 20},
+        uint32_t duration_ms=10000);
+    // messages/s against the transmit window size per loss rate, on a link
+    // with latency_us one way latency
+    void bench_window(
+        std::vector<bench_result_t> &results, const std::vector<uint8_t> &window_sizes={1, 2, 4, 8},
+        const std::vector<uint8_t> &loss_percent={0, 10}, uint32_t latency_us=2000, uint32_t duration_ms=5000);
+    // one node broadcasting to receivers per broadcast mode and loss rate:
+    // share of the time the medium was busy, frames and deliveries
+    void bench_broadcast(
+        std::vector<bench_result_t> &results, uint8_t receivers=4, const std::vector<uint8_t> &loss_percent={0, 10},
+        uint32_t interval_ms=50, uint32_t duration_ms=5000);
+    // a sender flooding a receiver that only takes one frame every
+    // loop_interval_ms, with and without flow control
+    void bench_overload(std::vector<bench_result_t> &results, uint32_t loop_interval_ms=5, uint32_t duration_ms=10000);
+    // a burst of updates to one value, sent keyed and unkeyed: whether and
+    // when the final value arrived, and the frames it took
+    void bench_coalesce(std::vector<bench_result_t> &results, uint8_t loss_percent=0, uint32_t updates=200);
+
+    std::string bench_to_json(const std::vector<bench_result_t> &results);
+    // the named groups with defaults, all of them if empty
+    std::string run_benchmarks(const std::vector<std::string> &groups={});
+
+}  // namespace espnow_proxy
+}  // namespace esphome
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace sensor {
+
+    class Sensor {
+        public:
+            void publish_state(float state) { state_ = state; }
+            float get_state() const { return state_; }
+
+        protected:
+            float state_{0};
+    };
+
+}  // namespace sensor
+}  // namespace esphome
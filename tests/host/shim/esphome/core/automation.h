@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <tuple>
+
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+    // the subset of esphome automations the component uses: templatable
+    // values, triggers calling an action and actions chained with play_next_
+    template<typename T, typename... X> class TemplatableValue {
+        public:
+            TemplatableValue() {}
+            TemplatableValue(T value) : value_(std::move(value)), has_value_(true) {}
+            template<typename F, typename = decltype(std::declval<F>()(std::declval<X>()...))>
+            TemplatableValue(F f) : f_(f), has_value_(true) {}
+
+            bool has_value() { return has_value_; }
+            T value(X... x) { return f_ ? f_(x...) : value_; }
+
+        private:
+            T value_{};
+            std::function<T(X...)> f_;
+            bool has_value_{false};
+    };
+
+    #define TEMPLATABLE_VALUE_(type, name) \
+        protected: \
+            TemplatableValue<type, Ts...> name##_{}; \
+\
+        public: \
+            template<typename V> void set_##name(V name) { this->name##_ = name; }
+
+    #define TEMPLATABLE_VALUE(type, name) TEMPLATABLE_VALUE_(type, name)
+
+    template<typename... Ts> class Action {
+        public:
+            virtual ~Action() {}
+            virtual void play_complex(Ts... x) {
+                this->num_running_++;
+                this->play(x...);
+                this->play_next_(x...);
+            }
+            virtual void stop_complex() {
+                if (this->num_running_) {
+                    this->stop();
+                    this->num_running_ = 0;
+                }
+                if (this->next_) {
+                    this->next_->stop_complex();
+                }
+            }
+            virtual bool is_running() { return this->num_running_ > 0 || (this->next_ && this->next_->is_running()); }
+            void set_next(Action<Ts...> *next) { this->next_ = next; }
+
+        protected:
+            virtual void play(Ts... x) = 0;
+            void play_next_(Ts... x) {
+                if (this->num_running_ > 0) {
+                    this->num_running_--;
+                    if (this->next_) {
+                        this->next_->play_complex(x...);
+                    }
+                }
+            }
+            virtual void stop() {}
+
+            Action<Ts...> *next_{nullptr};
+            int num_running_{0};
+    };
+
+    template<typename... Ts> class Trigger {
+        public:
+            void trigger(Ts... x) {
+                if (this->action_) {
+                    this->action_->play_complex(x...);
+                }
+            }
+            void set_action(Action<Ts...> *action) { this->action_ = action; }
+
+        protected:
+            Action<Ts...> *action_{nullptr};
+    };
+
+    // action running a function, stands in for lambda actions
+    template<typename... Ts> class LambdaAction : public Action<Ts...> {
+        public:
+            explicit LambdaAction(std::function<void(Ts...)> &&f) : f_(std::move(f)) {}
+
+        protected:
+            void play(Ts... x) override { this->f_(x...); }
+
+            std::function<void(Ts...)> f_;
+    };
+
+}  // namespace esphome
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+    namespace setup_priority {
+
+        extern const float DATA;
+        extern const float WIFI;
+        extern const float AFTER_WIFI;
+
+    }  // namespace setup_priority
+
+    class Component {
+        public:
+            virtual ~Component() {}
+            virtual void setup() {}
+            virtual void loop() {}
+            virtual void dump_config() {}
+            virtual float get_setup_priority() const { return 0; }
+            virtual void on_shutdown() {}
+            virtual void on_safe_shutdown() {}
+    };
+
+    class PollingComponent : public Component {
+        public:
+            PollingComponent() {}
+            PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+            virtual void update() = 0;
+            uint32_t get_update_interval() const { return update_interval_; }
+
+        protected:
+            uint32_t update_interval_{0};
+    };
+
+}  // namespace esphome
@@ -0,0 +1,7 @@
+#pragma once
+
+// host builds of the component outside of esphome, the tests configure the
+// rest through compile definitions
+#ifndef USE_HOST
+#define USE_HOST
+#endif
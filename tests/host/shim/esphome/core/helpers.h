@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace esphome {
+
+    template<typename... X> class CallbackManager;
+
+    template<typename... Ts> class CallbackManager<void(Ts...)> {
+        public:
+            void add(std::function<void(Ts...)> &&callback) { callbacks_.push_back(std::move(callback)); }
+            void call(Ts... args) {
+                for (auto &callback : callbacks_) {
+                    callback(args...);
+                }
+            }
+            size_t size() const { return callbacks_.size(); }
+
+        protected:
+            std::vector<std::function<void(Ts...)>> callbacks_;
+    };
+
+    class Mutex {
+        public:
+            void lock() { mutex_.lock(); }
+            bool try_lock() { return mutex_.try_lock(); }
+            void unlock() { mutex_.unlock(); }
+
+        private:
+            std::recursive_mutex mutex_;
+    };
+
+    class LockGuard {
+        public:
+            LockGuard(Mutex &mutex) : mutex_(mutex) { mutex_.lock(); }
+            ~LockGuard() { mutex_.unlock(); }
+
+        private:
+            Mutex &mutex_;
+    };
+
+    template<typename T> class Parented {
+        public:
+            Parented() {}
+            Parented(T *parent) : parent_(parent) {}
+            T *get_parent() const { return parent_; }
+            void set_parent(T *parent) { parent_ = parent; }
+
+        protected:
+            T *parent_{nullptr};
+    };
+
+    uint32_t random_uint32();
+    uint32_t fnv1_hash(const std::string &str);
+
+}  // namespace esphome
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+    // in memory preferences, kept for the lifetime of the process so a
+    // proxy set up again restores what the previous one saved
+    class ESPPreferenceObject {
+        public:
+            ESPPreferenceObject() {}
+            ESPPreferenceObject(std::vector<uint8_t> *data) : data_(data) {}
+
+            template<typename T> bool save(const T *src) {
+                if (!data_) {
+                    return false;
+                }
+                data_->assign((const uint8_t *)src, (const uint8_t *)src + sizeof(T));
+                return true;
+            }
+
+            template<typename T> bool load(T *dest) {
+                if (!data_ || data_->size() != sizeof(T)) {
+                    return false;
+                }
+                memcpy(dest, data_->data(), sizeof(T));
+                return true;
+            }
+
+        private:
+            std::vector<uint8_t> *data_{nullptr};
+    };
+
+    class ESPPreferences {
+        public:
+            template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+                return ESPPreferenceObject(&data_[type]);
+            }
+            template<typename T> ESPPreferenceObject make_preference(uint32_t type) {
+                return make_preference<T>(type, false);
+            }
+            bool sync() { return true; }
+            void reset() { data_.clear(); }
+
+        private:
+            std::map<uint32_t, std::vector<uint8_t>> data_;
+    };
+
+    extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
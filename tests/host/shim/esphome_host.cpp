@@ -0,0 +1,73 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+#include "radio.h"
+
+namespace esphome {
+
+    namespace setup_priority {
+
+        const float DATA = 600.0f;
+        const float WIFI = 250.0f;
+        const float AFTER_WIFI = 200.0f;
+
+    }  // namespace setup_priority
+
+    static ESPPreferences host_preferences;
+    ESPPreferences *global_preferences = &host_preferences;
+
+    static int host_log_level_() {
+
+        const char *level = getenv("ESPNOW_PROXY_LOG_LEVEL");
+        return level ? atoi(level) : ESPHOME_LOG_LEVEL_NONE;
+
+    }
+
+    int host_log_level = host_log_level_();
+
+    void host_log(int level, const char *tag, const char *format, ...) {
+
+        static const char LEVELS[] = "-EWICDVV";
+        fprintf(stderr, "[%c][%s]: ", LEVELS[level & 7], tag);
+        va_list args;
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fputc('\n', stderr);
+
+    }
+
+    // time is the virtual clock of the simulated medium
+    uint32_t millis() {
+        return espnow_proxy_base::clock_millis();
+    }
+
+    uint32_t micros() {
+        return espnow_proxy_base::clock_micros();
+    }
+
+    void delay(uint32_t ms) {
+    }
+
+    uint32_t random_uint32() {
+        return espnow_proxy_base::clock_random();
+    }
+
+    uint32_t fnv1_hash(const std::string &str) {
+
+        uint32_t hash = 2166136261UL;
+        for (char c : str) {
+            hash *= 16777619UL;
+            hash ^= c;
+        }
+        return hash;
+
+    }
+
+}  // namespace esphome
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "sim_network.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+// A hub and sensor nodes on a lossy simulated medium. Every sensor sends a
+// reading to the hub every 100ms, the hub broadcasts a command every second.
+//
+//   sim_example [nodes] [loss percent] [seconds]
+int main(int argc, char **argv) {
+
+    uint8_t nodes = argc > 1 ? atoi(argv[1]) : 4;
+    uint8_t loss = argc > 2 ? atoi(argv[2]) : 10;
+    uint32_t seconds = argc > 3 ? atoi(argv[3]) : 10;
+    if (nodes < 2 || nodes > RADIO_NODE_LEN) {
+        fprintf(stderr, "nodes must be 2..%d\n", RADIO_NODE_LEN);
+        return 2;
+    }
+
+    sim_config_t config{};
+    config.loss_percent = loss;
+    config.latency = 500;
+    config.jitter = 200;
+    SimNetwork network(config);
+    for (uint8_t node = 0; node < nodes; node++) {
+        network.add();
+    }
+    for (uint8_t node = 1; node < nodes; node++) {
+        network.connect(node, 0);
+    }
+
+    uint32_t readings = 0;
+    uint32_t commands = 0;
+    network.get(0)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+        readings++;
+    });
+    for (uint8_t node = 1; node < nodes; node++) {
+        network.get(node)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+            commands++;
+        });
+    }
+    network.setup();
+
+    uint32_t tick = 0;
+    uint32_t sent = 0;
+    network.run(seconds * 1000, [&]() {
+        if (tick % 100 == 0) {
+            for (uint8_t node = 1; node < nodes; node++) {
+                network.select(node);
+                sent += (bool)network.get(node)->send("reading " + std::to_string(tick));
+            }
+        }
+        if (tick % 1000 == 0) {
+            network.select(0);
+            network.get(0)->send("command", send_options_t{addr_to_addr64(BROADCAST)});
+        }
+        tick++;
+    });
+    // let the last readings arrive
+    network.run(SEND_TIMEOUT_MS);
+
+    auto &medium = network.medium();
+    printf("nodes: %d loss: %d%% seconds: %u\n", nodes, loss, seconds);
+    printf("readings sent: %u received: %u\n", sent, readings);
+    printf("commands received: %u of %u\n", commands, (nodes - 1) * ((seconds * 1000 + 999) / 1000));
+    printf(
+        "medium frames: %u lost: %u utilization: %d%%\n",
+        medium.get_stats().sent, medium.get_stats().lost, medium.get_utilization());
+    for (uint8_t node = 1; node < nodes; node++) {
+        network.select(node);
+        link_stats_t *stats = network.get(node)->get_link(network.address(0))->get_stats();
+        printf(
+            "node %d: delivered: %u retransmits: %u timeouts: %u\n",
+            node, stats->delivered, stats->retransmits, stats->timeouts);
+    }
+
+    // every reading is acked, none may get lost at moderate loss
+    return readings == sent ? 0 : 1;
+
+}
@@ -0,0 +1,73 @@
+#include "sim_network.h"
+
+namespace esphome {
+namespace espnow_proxy {
+
+    SimNetwork::SimNetwork(const sim_config_t &config) {
+
+        medium().configure(config);
+
+    }
+
+    void SimNetwork::connect(uint8_t a, uint8_t b) {
+
+        for (auto pair : {std::make_pair(a, b), std::make_pair(b, a)}) {
+            select(pair.first);
+            ESPNowProxy *proxy = get(pair.first);
+            if (!proxy->get_address()) {
+                proxy->set_address(address(pair.second));
+            }
+            proxy->set_peer(address(pair.second));
+        }
+
+    }
+
+    void SimNetwork::setup() {
+
+        for (size_t node = 0; node < size(); node++) {
+            select(node);
+            get(node)->setup();
+        }
+
+    }
+
+    void SimNetwork::step_(const std::function<void()> &on_tick) {
+
+        if (on_tick) {
+            on_tick();
+        }
+        for (size_t node = 0; node < size(); node++) {
+            if (ticks_ % intervals_[node] == 0) {
+                select(node);
+                get(node)->loop();
+            }
+        }
+        ticks_++;
+        medium().advance(tick_);
+
+    }
+
+    void SimNetwork::run(uint32_t ms, const std::function<void()> &on_tick) {
+
+        uint64_t until = medium().now() + (uint64_t)ms * 1000;
+        while (medium().now() < until) {
+            step_(on_tick);
+        }
+
+    }
+
+    bool SimNetwork::run_until(const std::function<bool()> &done, uint32_t timeout_ms) {
+
+        uint64_t until = medium().now() + (uint64_t)timeout_ms * 1000;
+        while (!done()) {
+            if (medium().now() >= until) {
+                return false;
+            }
+            step_(nullptr);
+        }
+        return true;
+
+    }
+
+}  // namespace espnow_proxy
+}  // namespace esphome
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "espnow_proxy.h"
+#include "radio_sim.h"
+
+namespace esphome {
+namespace espnow_proxy {
+
+    using namespace espnow_proxy_base;
+
+    // node n of the network has the address SIM_NODE_ADDRESS + n
+    static const mac_address_t SIM_NODE_ADDRESS = 0x020000005100ULL;
+
+    // Several unmodified ESPNowProxy instances on the simulated medium of
+    // one process. Nodes are added and connected, then set up and run tick
+    // by tick, every node loops once per tick and the virtual clock advances
+    // in between:
+    //
+    //   SimNetwork network(config);
+    //   network.add();  // node 0
+    //   network.add();  // node 1
+    //   network.connect(0, 1);
+    //   network.setup();
+    //   network.select(0); network.get(0)->send("hello");
+    //   network.run(100);
+    //
+    // The medium and the base callbacks are process wide, one network per
+    // process.
+    class SimNetwork {
+
+        public:
+            explicit SimNetwork(const sim_config_t &config = sim_config_t{});
+
+            // constructs the proxy of the next node with the node selected,
+            // T may expose protected members to a test
+            template<typename T = ESPNowProxy> T *add() {
+                uint8_t node = medium().add_node(SIM_NODE_ADDRESS + proxies_.size());
+                medium().select(node);
+                T *proxy = new T();
+                proxies_.push_back(proxy);
+                intervals_.push_back(1);
+                return proxy;
+            }
+
+            // both nodes know each other as peer, the first peer connected is
+            // the default destination of a node
+            void connect(uint8_t a, uint8_t b);
+            void setup();
+
+            // loop every node once per tick, on_tick runs before the loops
+            void run(uint32_t ms, const std::function<void()> &on_tick = nullptr);
+            // run until done returns true, false on timeout
+            bool run_until(const std::function<bool()> &done, uint32_t timeout_ms);
+            // loop a node only every ticks ticks, a slow receiver
+            void set_loop_interval(uint8_t node, uint32_t ticks) { intervals_[node] = ticks ? ticks : 1; }
+            void set_tick(uint32_t us) { tick_ = us; }
+
+            // calls into a proxy from outside of run need its node selected
+            void select(uint8_t node) { medium().select(node); }
+            ESPNowProxy *get(uint8_t node) { return proxies_[node]; }
+            mac_address_t address(uint8_t node) const { return SIM_NODE_ADDRESS + node; }
+            size_t size() const { return proxies_.size(); }
+            SimMedium &medium() { return SimMedium::get(); }
+
+        protected:
+            std::vector<ESPNowProxy *> proxies_;
+            std::vector<uint32_t> intervals_;
+            uint32_t tick_{1000};  // us
+            uint32_t ticks_{0};
+
+            void step_(const std::function<void()> &on_tick);
+
+    };
+
+}  // namespace espnow_proxy
+}  // namespace esphome
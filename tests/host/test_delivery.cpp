@@ -0,0 +1,140 @@
+#include <vector>
+
+#include "automation.h"
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+static const uint8_t SENDER = 0;
+static const uint8_t RECEIVER = 1;
+
+// node without a radio, unicast frames to it are never acked
+static const mac_address_t ABSENT = SIM_NODE_ADDRESS + 0xFF;
+
+struct delivered_t {
+    uint32_t id;
+    uint8_t status;
+};
+
+// Delivery handles and the send action waiting for the ack. Every handle
+// gets one final status, by callback and from get_delivery_status(), and
+// the actions after `wait_until: acked` only run for acked messages.
+int main() {
+
+    SimNetwork network;
+    network.add();
+    network.add();
+    network.connect(SENDER, RECEIVER);
+    std::vector<delivered_t> reported;
+    ESPNowProxy *sender = network.get(SENDER);
+    sender->add_on_delivery_callback([&](const mac_address_t address, uint32_t id, uint8_t status) {
+        reported.push_back(delivered_t{id, status});
+    });
+    network.setup();
+
+    // acked: the callback of the send and the trigger report the same handle
+    send_options_t options{};
+    options.address = network.address(RECEIVER);
+    delivered_t acked{0, Delivery_Pending};
+    options.on_delivery = [&](delivery_handle_t handle, uint8_t status) {
+        acked = delivered_t{handle.id, status};
+    };
+    network.select(SENDER);
+    delivery_handle_t handle = sender->send("acked", options);
+    CHECK(handle);
+    CHECK_EQ(sender->get_delivery_status(handle), Delivery_Pending);
+    CHECK(network.run_until([&]() { return acked.status != Delivery_Pending; }, 1000));
+    network.select(SENDER);
+    CHECK_EQ(acked.id, handle.id);
+    CHECK_EQ(acked.status, Delivery_Acked);
+    CHECK_EQ(sender->get_delivery_status(handle), Delivery_Acked);
+    CHECK_EQ(reported.size(), 1);
+    CHECK_EQ(reported.back().id, handle.id);
+
+    // timeout: nobody acks
+    delivered_t timeout{0, Delivery_Pending};
+    options.address = ABSENT;
+    options.on_delivery = [&](delivery_handle_t handle, uint8_t status) {
+        timeout = delivered_t{handle.id, status};
+    };
+    handle = sender->send("timeout", options);
+    CHECK(handle);
+    CHECK(network.run_until([&]() { return timeout.status != Delivery_Pending; }, 2 * SEND_TIMEOUT_MS));
+    network.select(SENDER);
+    CHECK_EQ(timeout.id, handle.id);
+    CHECK_EQ(timeout.status, Delivery_Timeout);
+    CHECK_EQ(sender->get_delivery_status(handle), Delivery_Timeout);
+
+    // dropped: a cancelled reservation and a send that was not queued
+    options.address = network.address(RECEIVER);
+    delivered_t cancelled{0, Delivery_Pending};
+    options.on_delivery = [&](delivery_handle_t handle, uint8_t status) {
+        cancelled = delivered_t{handle.id, status};
+    };
+    send_data_t *message = sender->reserve_send(options);
+    CHECK(message != nullptr);
+    sender->cancel_send(message);
+    network.run(10);
+    CHECK_EQ(cancelled.status, Delivery_Dropped);
+    delivered_t rejected{1, Delivery_Pending};
+    options.on_delivery = [&](delivery_handle_t handle, uint8_t status) {
+        rejected = delivered_t{handle.id, status};
+    };
+    network.select(SENDER);
+    sender->set_max_queue_length(1);
+    sender->send("queued", send_options_t{network.address(RECEIVER)});
+    handle = sender->send("rejected", options);
+    CHECK(!handle);
+    CHECK_EQ(sender->get_delivery_status(handle), Delivery_Dropped);
+    network.run(100);
+    CHECK_EQ(rejected.id, 0);
+    CHECK_EQ(rejected.status, Delivery_Dropped);
+    network.select(SENDER);
+    sender->set_max_queue_length(5);  // the default
+
+    // wait_until: acked, the next action runs once the receiver acked
+    SendAction<> send_action;
+    send_action.set_parent(sender);
+    send_action.set_data(std::string("action"));
+    send_action.set_address(network.address(RECEIVER));
+    send_action.set_wait_acked(true);
+    uint32_t continued = 0;
+    LambdaAction<> next([&]() { continued++; });
+    send_action.set_next(&next);
+    network.select(SENDER);
+    send_action.play_complex();
+    CHECK_EQ(continued, 0);
+    CHECK(send_action.is_running());
+    CHECK(network.run_until([&]() { return continued == 1; }, 1000));
+    CHECK(!send_action.is_running());
+
+    // a message that timed out ends the automation
+    send_action.set_address(ABSENT);
+    network.select(SENDER);
+    send_action.play_complex();
+    network.run(2 * SEND_TIMEOUT_MS);
+    CHECK_EQ(continued, 1);
+    CHECK(!send_action.is_running());
+
+    // stopped before the ack, the delivery does not continue it
+    send_action.set_address(network.address(RECEIVER));
+    network.select(SENDER);
+    send_action.play_complex();
+    send_action.stop_complex();
+    network.run(100);
+    CHECK_EQ(continued, 1);
+    CHECK(!send_action.is_running());
+
+    // without waiting the next action runs right away
+    send_action.set_wait_acked(false);
+    network.select(SENDER);
+    send_action.play_complex();
+    CHECK_EQ(continued, 2);
+    network.run(100);
+
+    printf("delivery: %u reported, %u continued\n", (uint32_t)reported.size(), continued);
+    return TEST_RESULT();
+
+}
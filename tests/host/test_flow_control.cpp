@@ -0,0 +1,163 @@
+#include <string>
+#include <vector>
+
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+static const uint8_t SENDER = 0;
+static const uint8_t DROP_NEWEST = 1;
+static const uint8_t DROP_OLDEST = 2;
+static const uint8_t DROP_PRIORITY = 3;
+static const uint8_t RECEIVER = 4;
+static const uint8_t SENDER_2 = 5;
+static const uint8_t ACK_RECEIVER = 6;
+
+static const uint16_t RECV_LIMIT = 4;
+static const uint8_t BURST = 8;
+
+// a burst of frames from the sender node reaches the receiver while it
+// does not loop, every second frame is bulk
+static std::vector<std::string> burst(SimNetwork &network, uint8_t node, std::vector<std::string> &delivered) {
+
+    delivered.clear();
+    for (uint8_t n = 0; n < BURST; n++) {
+        network.select(SENDER);
+        uint8_t priority = n % 2 ? Priority_Bulk : Priority_Telemetry;
+        std::string data = "m" + std::to_string(n);
+        send_command(
+            addr64_to_addr(network.address(node)), Command_Data | (priority << COMMAND_PRIORITY_SHIFT),
+            (uint8_t *)data.data(), data.size(), n + 1);
+        network.medium().advance(2000);
+    }
+    network.select(node);
+    network.get(node)->loop();
+    return delivered;
+
+}
+
+// Receivers above their limit drop by policy, and advertise a credit so
+// senders do not overrun them. Every policy takes RECV_LIMIT frames of a
+// burst; the sender of the burst does not retransmit, what is delivered
+// shows what was dropped.
+int main() {
+
+    SimNetwork network;
+    for (uint8_t node = 0; node <= ACK_RECEIVER; node++) {
+        network.add();
+    }
+    for (uint8_t node : {DROP_NEWEST, DROP_OLDEST, DROP_PRIORITY, RECEIVER, ACK_RECEIVER}) {
+        network.connect(SENDER, node);
+    }
+    network.connect(SENDER_2, RECEIVER);
+    std::vector<std::string> delivered;
+    uint32_t received = 0;
+    for (uint8_t node : {DROP_NEWEST, DROP_OLDEST, DROP_PRIORITY}) {
+        network.get(node)->set_recv_limit(RECV_LIMIT);
+        network.get(node)->set_loop_budget_messages(BURST);
+        network.get(node)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+            delivered.push_back(std::string(x));
+        });
+    }
+    network.get(DROP_NEWEST)->set_recv_drop_policy(RecvDrop_Newest);
+    network.get(DROP_OLDEST)->set_recv_drop_policy(RecvDrop_Oldest);
+    network.get(DROP_PRIORITY)->set_recv_drop_policy(RecvDrop_Priority);
+    network.get(RECEIVER)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+        received += address == network.address(SENDER);
+    });
+    network.setup();
+
+    // newest: the queue is full once the limit is reached
+    CHECK(burst(network, DROP_NEWEST, delivered) == (std::vector<std::string>{"m0", "m1", "m2", "m3"}));
+    CHECK_EQ(network.get(DROP_NEWEST)->get_recv_dropped(), BURST - RECV_LIMIT);
+
+    // oldest: frames waiting longest make room
+    CHECK(burst(network, DROP_OLDEST, delivered) == (std::vector<std::string>{"m4", "m5", "m6", "m7"}));
+    CHECK_EQ(network.get(DROP_OLDEST)->get_recv_dropped(), BURST - RECV_LIMIT);
+
+    // priority: bulk goes first
+    CHECK(burst(network, DROP_PRIORITY, delivered) == (std::vector<std::string>{"m0", "m2", "m4", "m6"}));
+    CHECK_EQ(network.get(DROP_PRIORITY)->get_recv_dropped(), BURST - RECV_LIMIT);
+
+    // credit: frames queued from another sender use up the credit of the
+    // sender, it holds back its messages until the receiver drained
+    network.get(RECEIVER)->set_recv_limit(RECV_LIMIT);
+    network.get(RECEIVER)->set_loop_budget_messages(1);
+    send_options_t options{};
+    options.address = network.address(RECEIVER);
+    network.select(SENDER);
+    network.get(SENDER)->send("reading", options);
+    network.get(SENDER)->loop();
+    network.medium().advance(2000);
+    // taken, the ack waits for the ack delay
+    network.select(RECEIVER);
+    network.get(RECEIVER)->loop();
+    for (uint8_t n = 0; n < RECV_LIMIT; n++) {
+        network.select(SENDER_2);
+        send_command_data(addr64_to_addr(options.address), (uint8_t *)"flood", 5, n + 1);
+        network.medium().advance(2000);
+    }
+    network.medium().advance(10000);
+    network.select(RECEIVER);
+    network.get(RECEIVER)->loop();
+    network.medium().advance(2000);
+    network.select(SENDER);
+    network.get(SENDER)->loop();
+    ESPNowProxyBase *link = network.get(SENDER)->get_link(options.address);
+    CHECK_EQ(link->get_stats()->delivered, 1);
+    CHECK_EQ(link->get_credit(), 0);
+
+    // nothing in flight without credit, a probe only follows a retransmit timeout
+    for (uint8_t n = 0; n < 3; n++) {
+        network.get(SENDER)->send("reading", options);
+    }
+    for (uint8_t tick = 0; tick < 100; tick++) {
+        network.select(SENDER);
+        network.get(SENDER)->loop();
+        network.medium().advance(1000);
+    }
+    auto queue = link->get_send_queue();
+    CHECK_EQ(queue->size(), 3);
+    for (auto it = queue->begin(); it != queue->end(); ++it) {
+        CHECK_EQ((*it)->retries, 0);
+    }
+
+    // the receiver reports its credit again once it drained
+    network.run(1000);
+    network.select(SENDER);
+    printf("credit: received %u credit %u dropped %u\n", received, link->get_credit(), network.get(RECEIVER)->get_recv_dropped());
+    CHECK_EQ(received, 4);
+    CHECK_EQ(link->get_stats()->delivered, 4);
+    CHECK_EQ(link->get_stats()->timeouts, 0);
+    CHECK(link->get_credit() >= RECV_LIMIT / 2);
+    CHECK_EQ(network.get(RECEIVER)->get_recv_dropped(), 0);
+
+    // an ack that could not be sent stays owed and goes out in the next
+    // loop, the sender does not wait for its retransmit timeout
+    network.get(ACK_RECEIVER)->set_ack_delay(0);
+    network.select(ACK_RECEIVER);
+    std::vector<tx_frame_t *> frames;
+    while (tx_frame_t *frame = alloc_frame()) {
+        frames.push_back(frame);
+    }
+    network.select(SENDER);
+    options.address = network.address(ACK_RECEIVER);
+    network.get(SENDER)->send("ack", options);
+    network.get(SENDER)->loop();
+    network.medium().advance(2000);
+    network.select(ACK_RECEIVER);
+    network.get(ACK_RECEIVER)->loop();
+    for (auto frame : frames) {
+        release_frame(frame);
+    }
+    network.run(50);
+
+    network.select(SENDER);
+    link_stats_t *stats = network.get(SENDER)->get_link(options.address)->get_stats();
+    CHECK_EQ(stats->delivered, 1);
+    CHECK_EQ(stats->retransmits, 0);
+    return TEST_RESULT();
+
+}
@@ -0,0 +1,129 @@
+#include <string>
+#include <vector>
+
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+static const uint32_t MESSAGES = 20;
+static const size_t MESSAGE_LEN = 1000;
+
+// node without a radio, unicast frames to it are never acked
+static const mac_address_t ABSENT = SIM_NODE_ADDRESS + 0xFF;
+
+static uint8_t pattern(uint32_t message, size_t pos) {
+
+    return pos == 0 ? message : (message * 7 + pos) & 0xFF;
+
+}
+
+// Fragmented messages sent back to back over a link that loses, reorders
+// and duplicates frames. A retransmitted fragment of one message must not
+// abort the next one, every message arrives complete and intact.
+int main() {
+
+    sim_config_t config{};
+    config.loss_percent = 10;
+    config.duplicate_percent = 5;
+    config.jitter = 3000;
+    SimNetwork network(config);
+    network.add();
+    network.add();
+    network.connect(0, 1);
+
+    std::vector<uint8_t> buffer;
+    uint32_t complete = 0;
+    uint32_t intact = 0;
+    uint32_t aborted = 0;
+    network.get(1)->add_on_stream_data_callback([&](const mac_address_t address, const stream_chunk_t chunk) {
+        if (chunk.aborted) {
+            aborted++;
+            buffer.clear();
+            return;
+        }
+        CHECK_EQ(chunk.offset, buffer.size());
+        buffer.insert(buffer.end(), chunk.data, chunk.data + chunk.size);
+        if (!chunk.last) {
+            return;
+        }
+        complete++;
+        bool ok = buffer.size() == MESSAGE_LEN;
+        for (size_t pos = 0; ok && pos < MESSAGE_LEN; pos++) {
+            ok = buffer[pos] == pattern(buffer[0], pos);
+        }
+        intact += ok;
+        buffer.clear();
+    });
+    uint32_t acked = 0;
+    uint32_t failed = 0;
+    network.get(0)->add_on_delivery_callback([&](const mac_address_t address, uint32_t id, uint8_t status) {
+        // sends that were not accepted report dropped without an id
+        if (id) {
+            acked += status == Delivery_Acked;
+            failed += status != Delivery_Acked;
+        }
+    });
+    network.setup();
+
+    uint32_t sent = 0;
+    bool done = network.run_until([&]() {
+        if (sent < MESSAGES) {
+            uint8_t data[MESSAGE_LEN];
+            for (size_t pos = 0; pos < MESSAGE_LEN; pos++) {
+                data[pos] = pattern(sent, pos);
+            }
+            network.select(0);
+            sent += (bool)network.get(0)->send(data, MESSAGE_LEN);
+        }
+        return acked + failed == MESSAGES;
+    }, 60000);
+
+    printf(
+        "sent: %u acked: %u failed: %u complete: %u intact: %u aborted: %u\n",
+        sent, acked, failed, complete, intact, aborted);
+    CHECK(done);
+    CHECK_EQ(acked, MESSAGES);
+    CHECK_EQ(complete, MESSAGES);
+    CHECK_EQ(intact, MESSAGES);
+    CHECK_EQ(aborted, 0);
+
+    // strings keep their terminator when fragmented, as in a single frame
+    std::string text(MESSAGE_LEN, 'x');
+    size_t received = 0;
+    bool terminated = false;
+    network.get(1)->add_on_stream_data_callback([&](const mac_address_t address, const stream_chunk_t chunk) {
+        if (chunk.last && !chunk.aborted) {
+            received = chunk.total_len;
+            terminated = chunk.data[chunk.size - 1] == 0;
+        }
+    });
+    send_options_t options{};
+    uint8_t status = Delivery_Pending;
+    options.on_delivery = [&](delivery_handle_t handle, uint8_t value) { status = value; };
+    network.select(0);
+    CHECK(network.get(0)->send(text, options));
+    CHECK(network.run_until([&]() { return status != Delivery_Pending; }, 10000));
+    CHECK_EQ(status, Delivery_Acked);
+    CHECK_EQ(received, MESSAGE_LEN + 1);
+    CHECK(terminated);
+
+    // a fragment that times out releases the other ones of its message,
+    // they are not retried until they time out on their own
+    options.address = ABSENT;
+    status = Delivery_Pending;
+    network.select(0);
+    CHECK(network.get(0)->send(text, options));
+    CHECK(network.run_until([&]() { return status != Delivery_Pending; }, 2 * SEND_TIMEOUT_MS));
+    network.select(0);
+    link_stats_t *stats = network.get(0)->get_link(ABSENT)->get_stats();
+    printf(
+        "timeout: status %d, timeouts %u, send pool in use %d\n",
+        status, stats->timeouts, (int)network.get(0)->get_send_queue_depth());
+    CHECK_EQ(status, Delivery_Timeout);
+    CHECK_EQ(stats->timeouts, 1);
+    CHECK_EQ(network.get(0)->get_send_queue_depth(), 0);
+    return TEST_RESULT();
+
+}
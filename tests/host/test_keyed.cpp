@@ -0,0 +1,134 @@
+#include <string>
+#include <vector>
+
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+static const uint8_t SENDER = 0;
+static const uint8_t RECEIVER = 1;
+
+static const uint8_t KEY = 1;
+static const uint8_t OTHER_KEY = 2;
+// updates between two loops, within the delivery table
+static const uint32_t BURST = 20;
+// updates of a slider, one per tick
+static const uint32_t SLIDER = 200;
+
+// Keyed sends of state updates. A newer value replaces an unsent one in
+// place and stops the retries of one in flight, the receiver always ends
+// with the latest value and the queue never overflows.
+int main() {
+
+    SimNetwork network;
+    network.add();
+    network.add();
+    network.connect(SENDER, RECEIVER);
+    std::vector<std::string> received;
+    network.get(RECEIVER)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+        received.push_back(std::string(x.data(), strnlen(x.data(), x.size())));
+    });
+    uint32_t acked = 0;
+    uint32_t replaced = 0;
+    uint32_t other = 0;
+    network.get(SENDER)->add_on_delivery_callback([&](const mac_address_t address, uint32_t id, uint8_t status) {
+        acked += status == Delivery_Acked;
+        replaced += status == Delivery_Replaced;
+        other += status != Delivery_Acked && status != Delivery_Replaced;
+    });
+    network.setup();
+
+    ESPNowProxy *sender = network.get(SENDER);
+    send_options_t options{};
+    options.address = network.address(RECEIVER);
+    options.key = KEY;
+    link_stats_t *stats = sender->get_link(options.address)->get_stats();
+
+    // coalescing: a burst between two loops takes one queue slot, every
+    // send is accepted and only the last value is sent
+    network.select(SENDER);
+    uint32_t accepted = 0;
+    for (uint32_t n = 0; n < BURST; n++) {
+        accepted += (bool)sender->send("v" + std::to_string(n), options);
+    }
+    CHECK_EQ(accepted, BURST);
+    CHECK_EQ(sender->get_link(options.address)->get_send_queue()->size(), 1);
+    CHECK(network.run_until([&]() { return acked + replaced + other == BURST; }, 1000));
+    CHECK(received == (std::vector<std::string>{"v" + std::to_string(BURST - 1)}));
+    CHECK_EQ(acked, 1);
+    CHECK_EQ(replaced, BURST - 1);
+    CHECK_EQ(other, 0);
+
+    // a slider moving for a while: every update gets its status, few are
+    // sent and the receiver ends with the last value
+    received.clear();
+    acked = replaced = 0;
+    uint32_t moved = 0;
+    network.run_until([&]() {
+        if (moved < SLIDER) {
+            network.select(SENDER);
+            sender->send("s" + std::to_string(moved++), options);
+        }
+        return acked + replaced + other == SLIDER;
+    }, 2000);
+    printf("slider: %u updates, %u sent\n", SLIDER, (uint32_t)received.size());
+    CHECK_EQ(acked + replaced, SLIDER);
+    CHECK_EQ(other, 0);
+    CHECK(received.back() == "s" + std::to_string(SLIDER - 1));
+    CHECK(received.size() < SLIDER / 4);
+
+    // one value in flight: the next waits for its ack and is replaced in
+    // place meanwhile
+    received.clear();
+    acked = replaced = 0;
+    network.select(SENDER);
+    sender->send("first", options);
+    sender->loop();
+    for (uint32_t n = 0; n < 10; n++) {
+        sender->send("w" + std::to_string(n), options);
+    }
+    CHECK(network.run_until([&]() { return acked + replaced == 11; }, 1000));
+    CHECK(received == (std::vector<std::string>{"first", "w9"}));
+    CHECK_EQ(acked, 2);
+    CHECK_EQ(replaced, 9);
+
+    // a lost value in flight is not retransmitted once replaced, the
+    // newer one follows after its retransmit timeout
+    received.clear();
+    acked = replaced = 0;
+    uint32_t retransmits = stats->retransmits;
+    sim_config_t config{};
+    config.loss_percent = 100;
+    network.medium().configure(config);
+    network.select(SENDER);
+    sender->send("lost", options);
+    network.run(5);
+    network.medium().configure(sim_config_t{});
+    network.select(SENDER);
+    sender->send("latest", options);
+    CHECK(network.run_until([&]() { return acked == 1 && replaced == 1; }, 2000));
+    CHECK(received == (std::vector<std::string>{"latest"}));
+    CHECK_EQ(stats->retransmits, retransmits);
+
+    // keys are independent, and so are unkeyed messages
+    received.clear();
+    acked = replaced = 0;
+    network.select(SENDER);
+    sender->send("a", options);
+    send_options_t other_key = options;
+    other_key.key = OTHER_KEY;
+    sender->send("b", other_key);
+    send_options_t unkeyed = options;
+    unkeyed.key = 0;
+    sender->send("c", unkeyed);
+    sender->send("d", unkeyed);
+    CHECK(network.run_until([&]() { return acked == 4; }, 1000));
+    CHECK_EQ(received.size(), 4);
+    CHECK_EQ(replaced, 0);
+
+    printf("keyed: replaced %u of link, retransmits %u\n", stats->replaced, stats->retransmits);
+    return TEST_RESULT();
+
+}
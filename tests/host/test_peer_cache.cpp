@@ -0,0 +1,78 @@
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+// destinations without a node, only registered with the radio
+static mac_address_t peer(uint8_t idx) {
+
+    return SIM_NODE_ADDRESS + 0x100 + idx;
+
+}
+
+static bool registered(mac_address_t address) {
+
+    const peer_registry_t *registry = get_peer_registry();
+    for (auto i = 0; i < registry->count; i++) {
+        if (registry->entries[i].address == address) {
+            return registry->entries[i].registered;
+        }
+    }
+    return false;
+
+}
+
+static void send_to(SimNetwork &network, mac_address_t address) {
+
+    uint8_t dest[MAC_ADDRESS_LEN];
+    uint8_t data[16] = {};
+    memcpy(dest, addr64_to_addr(address), MAC_ADDRESS_LEN);
+    espnow_proxy_base::send(dest, data, sizeof(data));
+    network.medium().advance(10000);
+
+}
+
+// A full radio peer table evicts the least recently used peer, but never
+// the broadcast peer or a peer with a frame still in flight.
+int main() {
+
+    SimNetwork network;
+    network.add();
+    network.setup();
+    network.select(0);
+
+    // the broadcast peer is the oldest one, followed by peer 0
+    mac_address_t broadcast = addr_to_addr64(BROADCAST);
+    send_to(network, broadcast);
+    for (uint8_t idx = 0; idx < RADIO_PEER_LEN - 1; idx++) {
+        send_to(network, peer(idx));
+    }
+    const peer_registry_t *registry = get_peer_registry();
+    CHECK_EQ(registry->registered, RADIO_PEER_LEN);
+    CHECK_EQ(registry->evictions, 0);
+
+    // a frame to peer 0 the radio has not completed yet
+    tx_frame_t *frame = alloc_frame();
+    CHECK(frame != nullptr);
+    memcpy(frame->dest, addr64_to_addr(peer(0)), MAC_ADDRESS_LEN);
+    frame->state.store(Frame_InFlight);
+
+    // peer 1 is the oldest one that can go
+    send_to(network, peer(100));
+    printf("evictions: %u, registered: %u\n", registry->evictions, registry->registered);
+    CHECK_EQ(registry->evictions, 1);
+    CHECK(registered(broadcast));
+    CHECK(registered(peer(0)));
+    CHECK(!registered(peer(1)));
+    CHECK(registered(peer(100)));
+
+    // once completed, peer 0 is the least recently used again
+    release_frame(frame);
+    send_to(network, peer(101));
+    CHECK_EQ(registry->evictions, 2);
+    CHECK(!registered(peer(0)));
+    CHECK(registered(broadcast));
+    return TEST_RESULT();
+
+}
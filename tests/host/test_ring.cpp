@@ -0,0 +1,105 @@
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "ring.h"
+#include "test.h"
+
+using namespace esphome::espnow_proxy_base;
+
+// A producer and a consumer thread hammering the receive ring, the way the
+// wifi task and the main loop share it. Every committed item must arrive
+// once, in order and intact, whatever the interleaving.
+
+static const uint32_t ITEMS = 200000;
+static const size_t PAYLOAD_LEN = 60;
+
+struct item_t {
+    uint32_t seq;
+    uint8_t data[PAYLOAD_LEN];
+    uint32_t sum;
+};
+
+static uint32_t checksum_(const item_t *item) {
+
+    uint32_t sum = item->seq;
+    for (size_t i = 0; i < PAYLOAD_LEN; i++) {
+        sum = sum * 31 + item->data[i];
+    }
+    return sum;
+
+}
+
+template<size_t N> static void stress_(size_t limit, bool peek) {
+
+    // a fresh ring per run, its high water mark is checked
+    auto owner = std::make_unique<SPSCRing<item_t, N>>();
+    auto &ring = *owner;
+    uint32_t committed = 0;
+
+    // producer retries a full ring, counts the acquire failures
+    std::thread producer([&]() {
+        for (uint32_t seq = 0; seq < ITEMS;) {
+            item_t *item = ring.acquire(limit);
+            if (!item) {
+                std::this_thread::yield();
+                continue;
+            }
+            item->seq = seq;
+            memset(item->data, seq & 0xFF, PAYLOAD_LEN);
+            item->data[seq % PAYLOAD_LEN] = ~seq;
+            item->sum = checksum_(item);
+            ring.commit();
+            committed++;
+            seq++;
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    while (expected < ITEMS) {
+        item_t *item = ring.front();
+        if (!item) {
+            std::this_thread::yield();
+            continue;
+        }
+        // committed slots behind the front are stable until popped
+        if (peek) {
+            size_t depth = ring.size();
+            for (size_t idx = 1; idx < depth; idx++) {
+                item_t *next = ring.peek(idx);
+                if (!next || next->seq != item->seq + idx || next->sum != checksum_(next)) {
+                    errors++;
+                }
+            }
+        }
+        if (item->seq != expected || item->sum != checksum_(item)) {
+            errors++;
+        }
+        CHECK(ring.size() <= limit);
+        ring.pop();
+        expected++;
+    }
+    producer.join();
+
+    CHECK_EQ(errors, 0);
+    CHECK_EQ(committed, ITEMS);
+    CHECK(ring.empty());
+    CHECK(ring.front() == nullptr);
+    CHECK(ring.get_high_water() <= limit);
+    printf(
+        "capacity: %zu limit: %zu peek: %d items: %u full: %u high water: %u\n",
+        N, limit, peek, ITEMS, ring.get_overflow(), ring.get_high_water());
+
+}
+
+int main() {
+
+    stress_<16>(16, false);
+    stress_<16>(16, true);
+    // the drop policies leave room above the limit
+    stress_<16>(12, true);
+    stress_<2>(2, false);
+    return TEST_RESULT();
+
+}
@@ -0,0 +1,147 @@
+#include <string>
+
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+static const uint8_t CALLER = 0;
+static const uint8_t CALLER_2 = 1;
+static const uint8_t SERVER = 2;
+static const uint8_t OTHER = 3;
+
+static const uint8_t METHOD_ECHO = 1;
+static const uint8_t METHOD_LATER = 2;
+static const uint8_t METHOD_MISSING = 9;
+
+// node without a radio, requests to it are never acked
+static const mac_address_t ABSENT = SIM_NODE_ADDRESS + 0xFF;
+
+struct result_t {
+    bool done = false;
+    uint8_t status = 0xFF;
+    std::string response;
+    uint32_t elapsed = 0;  // ms
+};
+
+static uint16_t call(SimNetwork &network, uint8_t node, mac_address_t address, uint8_t method, const std::string &data, result_t &result, uint32_t timeout=0) {
+
+    result = result_t{};
+    uint64_t start = network.medium().now();
+    network.select(node);
+    return network.get(node)->call(address, method, data, [&network, &result, start](uint8_t status, std::string_view response) {
+        result.done = true;
+        result.status = status;
+        result.response = std::string(response);
+        result.elapsed = (network.medium().now() - start) / 1000;
+    }, timeout);
+
+}
+
+// Calls between nodes. Responses reach the call they belong to, calls
+// without an answer time out, calls whose request is given up fail early
+// and methods without a handler are reported.
+int main() {
+
+    SimNetwork network;
+    for (uint8_t node = CALLER; node <= OTHER; node++) {
+        network.add();
+    }
+    network.connect(CALLER, SERVER);
+    network.connect(CALLER_2, SERVER);
+    network.connect(CALLER, OTHER);
+    rpc_request_t held{};
+    bool has_held = false;
+    network.get(SERVER)->register_method(METHOD_ECHO, [&](const rpc_request_t &request, std::string_view data) {
+        network.get(SERVER)->respond(request, std::string(data));
+    });
+    network.get(SERVER)->register_method(METHOD_LATER, [&](const rpc_request_t &request, std::string_view data) {
+        held = request;
+        has_held = true;
+    });
+    network.setup();
+
+    // correlation: both callers start with the same request id, each gets
+    // the answer to its own request
+    result_t first;
+    result_t second;
+    uint16_t first_id = call(network, CALLER, network.address(SERVER), METHOD_ECHO, "first", first);
+    uint16_t second_id = call(network, CALLER_2, network.address(SERVER), METHOD_ECHO, "second", second);
+    CHECK_EQ(first_id, second_id);
+    CHECK(network.run_until([&]() { return first.done && second.done; }, 1000));
+    CHECK_EQ(first.status, Rpc_Ok);
+    CHECK(first.response == "first");
+    CHECK_EQ(second.status, Rpc_Ok);
+    CHECK(second.response == "second");
+
+    // a call answered right away takes three frames: the request, the
+    // response acking it and the ack of the response
+    network.run(100);
+    uint32_t frames = network.medium().get_stats().sent;
+    result_t counted;
+    call(network, CALLER, network.address(SERVER), METHOD_ECHO, "counted", counted);
+    CHECK(network.run_until([&]() { return counted.done; }, 1000));
+    network.run(100);
+    frames = network.medium().get_stats().sent - frames;
+    CHECK_EQ(counted.status, Rpc_Ok);
+    CHECK_EQ(frames, 3);
+
+    // a response with the request id from another node does not answer the
+    // call, the one from the called node does
+    result_t later;
+    uint16_t later_id = call(network, CALLER, network.address(SERVER), METHOD_LATER, "", later, 1000);
+    CHECK(network.run_until([&]() { return has_held; }, 100));
+    network.select(OTHER);
+    uint8_t forged[RPC_HEADER_LEN + 6];
+    rpc_header_t header{later_id, METHOD_LATER, Rpc_Ok};
+    memcpy(forged, &header, RPC_HEADER_LEN);
+    memcpy(forged + RPC_HEADER_LEN, "forged", 6);
+    send_command(addr64_to_addr(network.address(CALLER)), Command_Response, forged, sizeof(forged), 1);
+    network.run(300);
+    CHECK(!later.done);
+
+    // a handler answering later does not make the caller retransmit, the
+    // request was acked after the ack delay
+    network.select(SERVER);
+    network.get(SERVER)->respond(held, "later");
+    CHECK(network.run_until([&]() { return later.done; }, 100));
+    CHECK_EQ(later.status, Rpc_Ok);
+    CHECK(later.response == "later");
+    network.select(CALLER);
+    CHECK_EQ(network.get(CALLER)->get_link(network.address(SERVER))->get_stats()->retransmits, 0);
+
+    // timeout: the handler never answers
+    has_held = false;
+    result_t timeout;
+    call(network, CALLER, network.address(SERVER), METHOD_LATER, "", timeout, 200);
+    CHECK(network.run_until([&]() { return timeout.done; }, 1000));
+    CHECK_EQ(timeout.status, Rpc_Timeout);
+    CHECK(timeout.elapsed >= 200 && timeout.elapsed < 250);
+    network.select(CALLER);
+    CHECK_EQ(network.get(CALLER)->get_rpc_stats(METHOD_LATER)->timeouts, 1);
+
+    // a response after the timeout is ignored
+    network.select(SERVER);
+    network.get(SERVER)->respond(held, "late");
+    network.run(100);
+
+    // dropped: the request times out at the link before the deadline of the call
+    result_t dropped;
+    call(network, CALLER, ABSENT, METHOD_ECHO, "", dropped, 10 * SEND_TIMEOUT_MS);
+    CHECK(network.run_until([&]() { return dropped.done; }, 5 * SEND_TIMEOUT_MS));
+    CHECK_EQ(dropped.status, Rpc_Dropped);
+    CHECK(dropped.elapsed < 2 * SEND_TIMEOUT_MS);
+
+    // unknown method
+    result_t unknown;
+    call(network, CALLER, network.address(SERVER), METHOD_MISSING, "", unknown);
+    CHECK(network.run_until([&]() { return unknown.done; }, 1000));
+    CHECK_EQ(unknown.status, Rpc_UnknownMethod);
+
+    printf(
+        "rpc: %u frames per call, later %u ms, timeout %u ms, dropped %u ms\n",
+        frames, later.elapsed, timeout.elapsed, dropped.elapsed);
+    return TEST_RESULT();
+
+}
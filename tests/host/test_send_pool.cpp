@@ -0,0 +1,62 @@
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+static const uint8_t SENDER = 0;
+static const uint8_t RECEIVER = 1;
+
+// peers without a radio, unicast frames to them are never acked
+static const mac_address_t ABSENT_A = SIM_NODE_ADDRESS + 0xFE;
+static const mac_address_t ABSENT_B = SIM_NODE_ADDRESS + 0xFF;
+
+// The send pool is shared by all peers. Peers that never ack fill their
+// queues, but must leave a slot for the others, a healthy peer still gets
+// its messages delivered.
+int main() {
+
+    SimNetwork network;
+    network.add();
+    network.add();
+    network.connect(SENDER, RECEIVER);
+    ESPNowProxy *sender = network.get(SENDER);
+    network.select(SENDER);
+    sender->set_peer(ABSENT_A);
+    sender->set_peer(ABSENT_B);
+    network.setup();
+
+    // the unreachable peers take what they can
+    send_options_t options{};
+    uint32_t queued = 0;
+    for (mac_address_t address : {ABSENT_A, ABSENT_B}) {
+        options.address = address;
+        for (int i = 0; i < 2 * SEND_POOL_LEN; i++) {
+            if (sender->send("lost", options)) {
+                queued++;
+            }
+        }
+    }
+    printf("queued for absent peers: %u / %d\n", queued, SEND_POOL_LEN);
+    CHECK(queued < SEND_POOL_LEN);
+    CHECK(sender->get_link(ABSENT_B)->get_stats()->dropped > 0);
+
+    // one after another, the healthy peer is served while they time out
+    uint32_t acked = 0;
+    options.address = network.address(RECEIVER);
+    for (int i = 0; i < 10; i++) {
+        uint8_t status = Delivery_Pending;
+        options.on_delivery = [&](delivery_handle_t handle, uint8_t value) { status = value; };
+        network.select(SENDER);
+        CHECK(sender->send("reading", options));
+        if (network.run_until([&]() { return status != Delivery_Pending; }, 1000) && status == Delivery_Acked) {
+            acked++;
+        }
+    }
+    network.select(SENDER);
+    printf("acked by the healthy peer: %u / 10\n", acked);
+    CHECK_EQ(acked, 10);
+    CHECK_EQ(sender->get_link(network.address(RECEIVER))->get_stats()->dropped, 0);
+    return TEST_RESULT();
+
+}
@@ -0,0 +1,43 @@
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+// The clock moves while loop() runs, as it does on the device. A frame sent
+// in this loop must not look overdue to a later pass of the same loop, on a
+// lossless link nothing is sent twice.
+int main() {
+
+    sim_config_t config{};
+    config.clock_step = 50;
+    SimNetwork network(config);
+    network.add();
+    network.add();
+    network.connect(0, 1);
+    uint32_t received = 0;
+    network.get(1)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+        received++;
+    });
+    network.setup();
+
+    uint32_t sent = 0;
+    network.run(2000, [&]() {
+        network.select(0);
+        while (sent < 200 && network.get(0)->send("reading")) {
+            sent++;
+        }
+    });
+    network.run(SEND_TIMEOUT_MS);
+
+    network.select(0);
+    link_stats_t *stats = network.get(0)->get_link(network.address(1))->get_stats();
+    printf("sent: %u received: %u retransmits: %u\n", sent, received, stats->retransmits);
+    CHECK_EQ(sent, 200);
+    CHECK_EQ(received, sent);
+    CHECK_EQ(stats->delivered, sent);
+    CHECK_EQ(stats->retransmits, 0);
+    CHECK_EQ(network.get(1)->get_link(network.address(0))->get_stats()->duplicates, 0);
+    return TEST_RESULT();
+
+}
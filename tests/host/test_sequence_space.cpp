@@ -0,0 +1,63 @@
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+// A sender numbers messages to a configured peer and acked broadcasts in
+// separate sequence spaces, so the same packet id reaches a receiver twice.
+// Neither one may be taken for a duplicate or acked by the ack of the other.
+int main() {
+
+    SimNetwork network;
+    network.add();
+    network.add();
+    network.connect(0, 1);
+    uint32_t unicast = 0;
+    uint32_t broadcast = 0;
+    network.get(1)->add_on_command_data_callback([&](const mac_address_t address, std::string_view x) {
+        if (x.substr(0, 7) == "unicast") {
+            unicast++;
+        } else if (x.substr(0, 9) == "broadcast") {
+            broadcast++;
+        }
+    });
+    uint32_t failed = 0;
+    network.get(0)->add_on_send_failed_callback([&]() {
+        failed++;
+    });
+    network.setup();
+
+    send_options_t to_peer{};
+    to_peer.address = network.address(1);
+    send_options_t to_all{};
+    to_all.address = addr_to_addr64(espnow_proxy_base::BROADCAST);
+    uint32_t sent = 0;
+    network.run(2000, [&]() {
+        network.select(0);
+        while (sent < 100) {
+            bool queued = sent % 2 ?
+                (bool)network.get(0)->send("broadcast", to_all) :
+                (bool)network.get(0)->send("unicast", to_peer);
+            if (!queued) {
+                break;
+            }
+            sent++;
+        }
+    });
+    network.run(SEND_TIMEOUT_MS);
+
+    network.select(1);
+    link_stats_t *stats = network.get(1)->get_link(network.address(0))->get_stats();
+    network.select(0);
+    size_t queued = network.get(0)->get_send_queue()->size() + network.get(0)->get_link(network.address(1))->get_send_queue()->size();
+    printf("sent: %u unicast: %u broadcast: %u queued: %u duplicates: %u\n", sent, unicast, broadcast, (unsigned)queued, stats->duplicates);
+    CHECK_EQ(sent, 100);
+    CHECK_EQ(unicast, 50);
+    CHECK_EQ(broadcast, 50);
+    CHECK_EQ(queued, 0);
+    CHECK_EQ(failed, 0);
+    CHECK_EQ(stats->duplicates, 0);
+    return TEST_RESULT();
+
+}
@@ -0,0 +1,79 @@
+#include "sim_network.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::espnow_proxy;
+
+// node without a radio, unicast frames to it are never delivered
+static const mac_address_t ABSENT = SIM_NODE_ADDRESS + 0xFF;
+
+// Transmit frames and their send status. A full window goes out in one
+// pass without running out of frames, and the status of every frame
+// reaches the message it carried.
+int main() {
+
+    SimNetwork network;
+    network.add();
+    network.add();
+    network.add();
+    network.connect(0, 1);
+    network.connect(0, 2);
+    network.setup();
+
+    // the send pool in flight at once, on a lossless link nothing is retried
+    ESPNowProxy *sender = network.get(0);
+    sender->set_window_size(SEND_POOL_LEN);
+    sender->set_max_queue_length(SEND_POOL_LEN);
+    send_options_t options{};
+    options.address = network.address(1);
+    uint32_t sent = 0;
+    network.run(2000, [&]() {
+        network.select(0);
+        while (sent < 200 && sender->send("reading", options)) {
+            sent++;
+        }
+    });
+    network.select(0);
+    link_stats_t *stats = sender->get_link(options.address)->get_stats();
+    CHECK_EQ(sent, 200);
+    CHECK_EQ(stats->delivered, sent);
+    CHECK_EQ(stats->retransmits, 0);
+    CHECK_EQ(espnow_proxy_base::get_state().frames_exhausted, 0);
+
+    // failed frames to an absent node count at its link, interleaved
+    // frames to the peer are not affected
+    send_options_t absent{};
+    absent.address = ABSENT;
+    uint32_t failed_before = stats->send_failed;
+    network.run(200, [&]() {
+        network.select(0);
+        sender->send("lost", absent);
+        sender->send("reading", options);
+    });
+    network.select(0);
+    CHECK(sender->get_link(ABSENT)->get_stats()->send_failed > 0);
+    CHECK_EQ(stats->send_failed, failed_before);
+    network.run(SEND_TIMEOUT_MS);
+
+    // a frame the radio could not deliver is retried after the minimum
+    // retransmit timeout, not after the initial one of the link
+    sender->set_retransmit_timeout(1000);
+    sim_config_t config{};
+    config.loss_percent = 100;
+    network.medium().configure(config);
+    options.address = network.address(2);
+    network.select(0);
+    sender->send("retry", options);
+    link_stats_t *retried = sender->get_link(options.address)->get_stats();
+    uint64_t start = network.medium().now();
+    network.run(5);
+    network.medium().configure(sim_config_t{});
+    bool done = network.run_until([&]() { return retried->delivered == 1; }, 1000);
+    uint32_t elapsed = (network.medium().now() - start) / 1000;
+    printf("retried after %u ms, send failed %u\n", elapsed, retried->send_failed);
+    CHECK(done);
+    CHECK_EQ(retried->send_failed, 1);
+    CHECK(elapsed < 100);
+    return TEST_RESULT();
+
+}